@@ -21,6 +21,7 @@
 #include "camera.hpp"
 #include "draw.hpp"
 #include "logger.hpp"
+#include "alg_diff.hpp"
 #include "alg.hpp"
 
 #define MAX2(x, y) ((x) > (y) ? (x) : (y))
@@ -29,20 +30,7 @@
 #define ABS(x)             ((x) < 0 ? -(x) : (x))
 #define DIFF(x, y)         (ABS((x)-(y)))
 #define NDIFF(x, y)        (ABS(x) * NORM / (ABS(x) + 2 * DIFF(x, y)))
-#define MAXS 10000               /* max depth of stack */
 #define EXCLUDE_LEVEL_PERCENT 20
-/* Increment for *smartmask_buffer in alg_diff_standard. */
-#define SMARTMASK_SENSITIVITY_INCR 5
-#define PUSH(Y, XL, XR, DY)     /* push new segment on stack */  \
-        if (sp<stack+MAXS && Y+(DY) >= 0 && Y+(DY) < height)     \
-        {sp->y = Y; sp->xl = XL; sp->xr = XR; sp->dy = DY; sp++;}
-
-#define POP(Y, XL, XR, DY)      /* pop segment off stack */      \
-        {sp--; Y = sp->y+(DY = sp->dy); XL = sp->xl; XR = sp->xr;}
-
-typedef struct {
-    int y, xl, xr, dy;
-} Segment;
 
 
 void cls_alg::noise_tune()
@@ -129,79 +117,74 @@ void cls_alg::threshold_tune()
     }
 }
 
-/*
- * Labeling by Joerg Weber. Based on an idea from Hubert Mara.
- * Floodfill enhanced by Ian McConnel based on code from
- * http://www.acm.org/pubs/tog/GraphicsGems/
- * http://www.codeproject.com/gdi/QuickFill.asp
-
- * Filled horizontal segment of scanline y for xl <= x <= xr.
- * Parent segment was on line y - dy.  dy = 1 or -1
- */
-int cls_alg::iflood(int x, int y, int width, int height,
-        u_char *out, int *labels, int newvalue, int oldvalue)
+/* Root run of the group, halving the path along the way */
+int cls_alg::label_find(int indx)
 {
-    int l, x1, x2, dy;
-    Segment stack[MAXS], *sp = stack; /* Stack of filled segments. */
-    int count = 0;
-
-    if (x < 0 || x >= width || y < 0 || y >= height) {
-        return 0;
+    while (runs[indx].parent != indx) {
+        runs[indx].parent = runs[runs[indx].parent].parent;
+        indx = runs[indx].parent;
     }
+    return indx;
+}
 
-    PUSH(y, x, x, 1);      /* Needed in some cases. */
-    PUSH(y + 1, x, x, -1); /* Seed segment (popped 1st). */
-
-    while (sp > stack) {
-        /* Pop segment off stack and fill a neighboring scan line. */
-        POP(y, x1, x2, dy);
-        /*
-         * Segment of scan line y-dy for x1<=x<=x2 was previously filled,
-         * now explore adjacent pixels in scan line y
-         */
-        for (x = x1; x >= 0 && out[y * width + x] != 0 && labels[y * width + x] == oldvalue; x--) {
-            labels[y * width + x] = newvalue;
-            count++;
-        }
-
-        if (x >= x1) {
-            goto skip;
-        }
-
-        l = x + 1;
-
-        if (l < x1) {
-            PUSH(y, l, x1 - 1, -dy); /* Leak on left? */
-        }
-
-        x = x1 + 1;
-
-        do {
-            for (; x < width && out[y * width + x] != 0 && labels[y * width + x] == oldvalue; x++) {
-                labels[y * width + x] = newvalue;
-                count++;
-            }
-
-            PUSH(y, l, x - 1, dy);
+/* Join the groups of two runs.  The root is always the earliest run. */
+void cls_alg::label_union(int indx1, int indx2)
+{
+    indx1 = label_find(indx1);
+    indx2 = label_find(indx2);
+    if (indx1 < indx2) {
+        runs[indx2].parent = indx1;
+        runs[indx1].size += runs[indx2].size;
+    } else if (indx2 < indx1) {
+        runs[indx1].parent = indx2;
+        runs[indx2].size += runs[indx1].size;
+    }
+}
 
-            if (x > x2 + 1) {
-                PUSH(y, x2 + 1, x - 1, -dy); /* Leak on right? */
-            }
+/*
+ * Find the next span of dirty tiles in the row of the tile map that starts
+ * at or after x_end.  The span is returned as pixel columns.
+ */
+bool cls_alg::tile_span(u_char *row_map, int *x_beg, int *x_end)
+{
+    int tx = (*x_end + TILE_SIZE - 1) / TILE_SIZE;
+    int cols = cam->imgs.tile_cols;
 
-        skip:
-            for (x++; x <= x2 && !(out[y * width + x] != 0 && labels[y * width + x] == oldvalue); x++);
-            l = x;
-        } while (x <= x2);
+    while ((tx < cols) && (row_map[tx] == 0)) {
+        tx++;
     }
-    return count;
+    if (tx == cols) {
+        return false;
+    }
+    *x_beg = tx * TILE_SIZE;
+    while ((tx < cols) && (row_map[tx] != 0)) {
+        tx++;
+    }
+    *x_end = MIN(tx * TILE_SIZE, cam->imgs.width);
+
+    return true;
 }
 
+/*
+ * Labeling by Joerg Weber. Based on an idea from Hubert Mara.
+ * The motion pixels of each row are collected into runs and each run is
+ * joined with the runs of the previous row that it touches (4-connected).
+ * The labels are numbered in the order that the flood fill found them:
+ * by the first pixel of the group that is not in the last row or column.
+ * Labels above the threshold have 32768 added in the label image and
+ * label numbers beyond 32767 share the last value.
+ * Only the dirty tiles of the motion image are scanned and written.
+ */
 int cls_alg::labeling()
 {
     ctx_images *imgs = &cam->imgs;
     u_char *out = imgs->image_motion.image_norm;
-    int *labels = imgs->labels;
-    int ix, iy, pixelpos;
+    uint16_t *labels = imgs->labels;
+    u_char *row, *row_map;
+    ctx_alg_run *run;
+    int x, y, x_beg, indx, root, fill, span_beg, span_end;
+    int prev_beg, prev_end, row_beg;
+    uint64_t skip;
     int width = imgs->width;
     int height = imgs->height;
     int labelsize = 0;
@@ -215,45 +198,136 @@ int cls_alg::labeling()
     imgs->labelgroup_max = 0;
     imgs->labels_above = 0;
 
-    /* Init: 0 means no label set / not checked. */
-    memset(labels, 0,(uint)(width * height) * sizeof(*labels));
-    pixelpos = 0;
+    /* Collect the runs and join them with the runs of the previous row */
+    run_cnt = 0;
+    prev_beg = 0;
+    prev_end = 0;
+    for (y = 0; y < height; y++) {
+        row = out + (y * width);
+        row_map = imgs->tile_dirty + ((y / TILE_SIZE) * imgs->tile_cols);
+        row_beg = run_cnt;
+        span_end = 0;
+        while (tile_span(row_map, &span_beg, &span_end)) {
+            x = span_beg;
+            while (x < span_end) {
+                while (x + 8 <= span_end) {
+                    memcpy(&skip, row + x, sizeof(skip));
+                    if (skip != 0) {
+                        break;
+                    }
+                    x += 8;
+                }
+                while ((x < span_end) && (row[x] == 0)) {
+                    x++;
+                }
+                if (x == span_end) {
+                    break;
+                }
+                x_beg = x;
+                while ((x < span_end) && (row[x] != 0)) {
+                    x++;
+                }
 
-    for (iy = 0; iy < height - 1; iy++) {
-        for (ix = 0; ix < width - 1; ix++, pixelpos++) {
-            /* No motion - no label */
-            if (out[pixelpos] == 0) {
-                labels[pixelpos] = 1;
-                continue;
+                if (run_cnt == run_max) {
+                    run_max *= 2;
+                    runs = (ctx_alg_run*)myrealloc(runs
+                        , (uint)run_max * sizeof(ctx_alg_run), "labeling");
+                }
+                run = &runs[run_cnt];
+                run->y = y;
+                run->x_beg = x_beg;
+                run->x_end = x;
+                run->parent = run_cnt;
+                run->size = x - x_beg;
+                run->label = 0;
+
+                while ((prev_beg < prev_end) && (runs[prev_beg].x_end <= x_beg)) {
+                    prev_beg++;
+                }
+                indx = prev_beg;
+                if ((indx < prev_end) && (runs[indx].x_beg < x)) {
+                    run->parent = label_find(indx);
+                    runs[run->parent].size += run->size;
+                    for (indx++; (indx < prev_end) && (runs[indx].x_beg < x); indx++) {
+                        label_union(indx, run_cnt);
+                    }
+                }
+                run_cnt++;
             }
+        }
+        prev_beg = row_beg;
+        prev_end = run_cnt;
+    }
 
-            /* Already visited by alg_iflood */
-            if (labels[pixelpos] > 0) {
-                continue;
-            }
+    for (indx = 0; indx < run_cnt; indx++) {
+        run = &runs[indx];
+        root = label_find(indx);
+        run->parent = root;
+        if ((run->y == height - 1) || (run->x_beg == width - 1)) {
+            continue;
+        }
+        if (runs[root].label != 0) {
+            continue;
+        }
+        runs[root].label = current_label;
+        labelsize = runs[root].size;
+
+        if (labelsize > cam->threshold) {
+            imgs->labelgroup_max += labelsize;
+            imgs->labels_above++;
+        } else if(max_under < labelsize) {
+            max_under = labelsize;
+        }
 
-            labelsize = iflood(ix, iy, width, height, out, labels, current_label, 0);
+        if (imgs->labelsize_max < labelsize) {
+            imgs->labelsize_max = labelsize;
+            imgs->largest_label = current_label;
+        }
 
-            if (labelsize > 0) {
-                /* Label above threshold? Mark it again (add 32768 to labelnumber). */
-                if (labelsize > cam->threshold) {
-                    labelsize = iflood(ix, iy, width, height, out, labels, current_label + 32768, current_label);
-                    imgs->labelgroup_max += labelsize;
-                    imgs->labels_above++;
-                } else if(max_under < labelsize) {
-                    max_under = labelsize;
-                }
+        cam->current_image->total_labels++;
+        current_label++;
+    }
 
-                if (imgs->labelsize_max < labelsize) {
-                    imgs->labelsize_max = labelsize;
-                    imgs->largest_label = current_label;
-                }
+    label_boxes();
 
-                cam->current_image->total_labels++;
-                current_label++;
+    /*
+     * Write the label image.  Pixels without motion are 1 except in the last
+     * row and column which are 0 as are groups that were not labeled.
+     */
+    indx = 0;
+    for (y = 0; y < height; y++) {
+        row_map = imgs->tile_dirty + ((y / TILE_SIZE) * imgs->tile_cols);
+        span_end = 0;
+        while (tile_span(row_map, &span_beg, &span_end)) {
+            fill = (y < height - 1) ? 1 : 0;
+            x = span_beg;
+            for (; (indx < run_cnt) && (runs[indx].y == y) &&
+                   (runs[indx].x_beg < span_end); indx++) {
+                run = &runs[indx];
+                for (; x < run->x_beg; x++) {
+                    labels[x] = (uint16_t)fill;
+                }
+                root = run->parent;
+                if (runs[root].label == 0) {
+                    fill = 0;
+                } else if (runs[root].size > cam->threshold) {
+                    fill = MIN(runs[root].label, 32767) + 32768;
+                } else {
+                    fill = MIN(runs[root].label, 32767);
+                }
+                for (; x < run->x_end; x++) {
+                    labels[x] = (uint16_t)fill;
+                }
+                fill = (y < height - 1) ? 1 : 0;
+            }
+            for (; x < span_end; x++) {
+                labels[x] = (uint16_t)fill;
+            }
+            if ((span_end == width) && (out[(y * width) + width - 1] == 0)) {
+                labels[width - 1] = 0;
             }
         }
-        pixelpos++; /* Compensate for ix < width - 1 */
+        labels += width;
     }
 
     /* Return group of significant labels or if that's none, the next largest
@@ -263,525 +337,837 @@ int cls_alg::labeling()
     return imgs->labelgroup_max ? imgs->labelgroup_max : max_under;
 }
 
-/**  Dilates a 3x3 box. */
-int cls_alg::dilate9(u_char *img, int width, int height, void *buffer)
+/*
+ * Bounding box and center of each label from the runs of the labeling.
+ * Runs of groups that were not labeled are skipped.
+ */
+void cls_alg::label_boxes()
 {
-    /*
-     * - row1, row2 and row3 represent lines in the temporary buffer.
-     * - Window is a sliding window containing max values of the columns
-     *   in the 3x3 matrix.
-     * - width is an index into the sliding window (this is faster than
-     *   doing modulo 3 on i).
-     * - blob keeps the current max value.
-     */
-    int y, i, sum = 0, widx;
-    u_char *row1, *row2, *row3, *rowTemp, *yp;
-    u_char window[3], blob, latest;
-
-    /* Set up row pointers in the temporary buffer. */
-    row1 = (u_char *)buffer;
-    row2 = row1 + width;
-    row3 = row2 + width;
-
-    /* Init rows 2 and 3. */
-    memset(row2, 0, (uint)width);
-    memcpy(row3, img, (uint)width);
+    ctx_alg_run *run;
+    ctx_coord *box;
+    int indx, lbl, total;
+    int64_t *sum;
+
+    total = cam->current_image->total_labels;
+    if (total > label_max) {
+        label_max = MAX(total, label_max * 2);
+        label_box = (ctx_coord*)myrealloc(label_box
+            , (uint)label_max * sizeof(ctx_coord), "label_boxes");
+        label_sum = (int64_t*)myrealloc(label_sum
+            , (uint)label_max * 2 * sizeof(int64_t), "label_boxes");
+    }
 
-    /* Pointer to the current row in img. */
-    yp = img;
+    for (lbl = 0; lbl < total; lbl++) {
+        box = &label_box[lbl];
+        box->minx = cam->imgs.width;
+        box->maxx = 0;
+        box->miny = cam->imgs.height;
+        box->maxy = 0;
+        label_sum[lbl * 2] = 0;
+        label_sum[lbl * 2 + 1] = 0;
+    }
 
-    for (y = 0; y < height; y++) {
-        /* Move down one step; row 1 becomes the previous row 2 and so on. */
-        rowTemp = row1;
-        row1 = row2;
-        row2 = row3;
-        row3 = rowTemp;
-
-        /* If we're at the last row, fill with zeros, otherwise copy from img. */
-        if (y == height - 1) {
-            memset(row3, 0, (uint)width);
-        } else {
-            memcpy(row3, yp + width, (uint)width);
+    for (indx = 0; indx < run_cnt; indx++) {
+        run = &runs[indx];
+        lbl = runs[run->parent].label - 2;
+        if (lbl < 0) {
+            continue;
         }
+        box = &label_box[lbl];
+        box->minx = MIN(box->minx, run->x_beg);
+        box->maxx = MAX(box->maxx, run->x_end - 1);
+        box->miny = MIN(box->miny, run->y);
+        box->maxy = MAX(box->maxy, run->y);
+        sum = &label_sum[lbl * 2];
+        sum[0] += (int64_t)(run->x_beg + run->x_end - 1) * (run->x_end - run->x_beg) / 2;
+        sum[1] += (int64_t)run->y * (run->x_end - run->x_beg);
+    }
 
-        /* Init slots 0 and 1 in the moving window. */
-        window[0] = MAX3(row1[0], row2[0], row3[0]);
-        window[1] = MAX3(row1[1], row2[1], row3[1]);
-
-        /* Init blob to the current max, and set window index. */
-        blob = MAX2(window[0], window[1]);
-        widx = 2;
-
-        /*
-         * Iterate over the current row; index i is off by one to eliminate
-         * a lot of +1es in the loop.
-         */
-        for (i = 2; i <= width - 1; i++) {
-            /* Get the max value of the next column in the 3x3 matrix. */
-            latest = window[widx] = MAX3(row1[i], row2[i], row3[i]);
-
-            /*
-             * If the value is larger than the current max, use it. Otherwise,
-             * calculate a new max (because the new value may not be the max.
-             */
-            if (latest >= blob) {
-                blob = latest;
-            } else {
-                blob = MAX3(window[0], window[1], window[2]);
-            }
-
-            /* Write the max value (blob) to the image. */
-            if (blob != 0) {
-                *(yp + i - 1) = blob;
-                sum++;
-            }
-
-            /* Wrap around the window index if necessary. */
-            if (++widx == 3) {
-                widx = 0;
-            }
+    for (indx = 0; indx < run_cnt; indx++) {
+        run = &runs[indx];
+        if ((run->parent != indx) || (run->label == 0)) {
+            continue;
         }
-
-        /* Store zeros in the vertical sides. */
-        *yp = *(yp + width - 1) = 0;
-        yp += width;
+        box = &label_box[run->label - 2];
+        box->x = (int)(label_sum[(run->label - 2) * 2] / run->size);
+        box->y = (int)(label_sum[(run->label - 2) * 2 + 1] / run->size);
+        box->width = box->maxx - box->minx + 1;
+        box->height = box->maxy - box->miny + 1;
     }
-
-    return sum;
 }
-
-/**  Dilates a + shape. */
-int cls_alg::dilate5(u_char *img, int width, int height, void *buffer)
+/*
+ * Collect the largest labels above the threshold as the objects of the
+ * image, largest first.  Returns the count of the objects.
+ */
+int cls_alg::track_objects(ctx_object *obj)
 {
-    /*
-     * - row1, row2 and row3 represent lines in the temporary buffer.
-     * - mem holds the max value of the overlapping part of two + shapes.
-     */
-    int y, i, sum = 0;
-    u_char *row1, *row2, *row3, *rowTemp, *yp;
-    u_char blob, mem, latest;
-
-    /* Set up row pointers in the temporary buffer. */
-    row1 = (u_char *)buffer;
-    row2 = row1 + width;
-    row3 = row2 + width;
+    ctx_alg_run *run;
+    int indx, pos, obj_cnt;
 
-    /* Init rows 2 and 3. */
-    memset(row2, 0, (uint)width);
-    memcpy(row3, img, (uint)width);
-
-    /* Pointer to the current row in img. */
-    yp = img;
+    obj_cnt = 0;
+    if (cam->current_image->total_labels == 0) {
+        return 0;
+    }
 
-    for (y = 0; y < height; y++) {
-        /* Move down one step; row 1 becomes the previous row 2 and so on. */
-        rowTemp = row1;
-        row1 = row2;
-        row2 = row3;
-        row3 = rowTemp;
-
-        /* If we're at the last row, fill with zeros, otherwise copy from img. */
-        if (y == height - 1) {
-            memset(row3, 0, (uint)width);
+    for (indx = 0; indx < run_cnt; indx++) {
+        run = &runs[indx];
+        if ((run->parent != indx) || (run->label == 0) ||
+            (run->size <= cam->threshold)) {
+            continue;
+        }
+        if (obj_cnt < OBJECT_MAX) {
+            pos = obj_cnt++;
+        } else if (obj[OBJECT_MAX - 1].size < run->size) {
+            pos = OBJECT_MAX - 1;
         } else {
-            memcpy(row3, yp + width, (uint)width);
+            continue;
         }
-
-        /* Init mem and set blob to force an evaluation of the entire + shape. */
-        mem = MAX2(row2[0], row2[1]);
-        blob = 1; /* dummy value, must be > 0 */
-
-        for (i = 1; i < width - 1; i++) {
-            /* Get the max value of the "right edge" of the + shape. */
-            latest = MAX3(row1[i], row2[i + 1], row3[i]);
-
-            if (blob == 0) {
-                /* In case the last blob is zero, only latest matters. */
-                blob = latest;
-                mem = row2[i + 1];
-            } else {
-                /* Otherwise, we have to check both latest and mem. */
-                blob = MAX2(mem, latest);
-                mem = MAX2(row2[i], row2[i + 1]);
-            }
-
-            /* Write the max value (blob) to the image. */
-            if (blob != 0) {
-                *(yp + i) = blob;
-                sum++;
-            }
+        while ((pos > 0) && (obj[pos - 1].size < run->size)) {
+            obj[pos] = obj[pos - 1];
+            pos--;
         }
-
-        /* Store zeros in the vertical sides. */
-        *yp = *(yp + width - 1) = 0;
-        yp += width;
+        obj[pos].id = 0;
+        obj[pos].size = run->size;
+        obj[pos].vx = 0;
+        obj[pos].vy = 0;
+        obj[pos].box = label_box[run->label - 2];
     }
-    return sum;
+
+    return obj_cnt;
 }
 
-/**  Erodes a 3x3 box. */
-int cls_alg::erode9(u_char *img, int width, int height, void *buffer, u_char flag)
+/*
+ * Pair the objects of the image with the tracked objects.  The box of each
+ * tracked object is moved by its speed for the images since it was last
+ * seen and the pairs with the largest overlap of the boxes are taken first.
+ * obj_trk is set to the index of the tracked object or -1.
+ */
+void cls_alg::track_match(ctx_object *obj, int obj_cnt, int *obj_trk)
 {
-    int y, i, sum = 0;
-    char *Row1, *Row2, *Row3;
-
-    Row1 = (char *)buffer;
-    Row2 = Row1 + width;
-    Row3 = Row1 + 2 * width;
-    memset(Row2, flag, (uint)width);
-    memcpy(Row3, img, (uint)width);
-
-    for (y = 0; y < height; y++) {
-        memcpy(Row1, Row2, (uint)width);
-        memcpy(Row2, Row3, (uint)width);
+    ctx_coord *box, *tbox;
+    bool trk_used[OBJECT_MAX];
+    int indx, trk, dx, dy, ovx, ovy, best, best_obj, best_trk;
+    int rate = MAX(cam->lastrate, 1);
 
-        if (y == height - 1) {
-            memset(Row3, flag, (uint)width);
-        } else {
-            memcpy(Row3, img + (y + 1) * width, (uint)width);
-        }
+    for (indx = 0; indx < obj_cnt; indx++) {
+        obj_trk[indx] = -1;
+    }
+    for (trk = 0; trk < track_cnt; trk++) {
+        trk_used[trk] = false;
+    }
 
-        for (i = width - 2; i >= 1; i--) {
-            if (Row1[i - 1] == 0 ||
-                Row1[i]     == 0 ||
-                Row1[i + 1] == 0 ||
-                Row2[i - 1] == 0 ||
-                Row2[i]     == 0 ||
-                Row2[i + 1] == 0 ||
-                Row3[i - 1] == 0 ||
-                Row3[i]     == 0 ||
-                Row3[i + 1] == 0) {
-                img[y * width + i] = 0;
-            } else {
-                sum++;
+    while (true) {
+        best = 0;
+        best_obj = -1;
+        best_trk = -1;
+        for (indx = 0; indx < obj_cnt; indx++) {
+            if (obj_trk[indx] != -1) {
+                continue;
+            }
+            box = &obj[indx].box;
+            for (trk = 0; trk < track_cnt; trk++) {
+                if (trk_used[trk]) {
+                    continue;
+                }
+                tbox = &track_list[trk].obj.box;
+                dx = track_list[trk].obj.vx * (track_list[trk].missed + 1) / rate;
+                dy = track_list[trk].obj.vy * (track_list[trk].missed + 1) / rate;
+                ovx = MIN(box->maxx, tbox->maxx + dx) - MAX(box->minx, tbox->minx + dx) + 1;
+                ovy = MIN(box->maxy, tbox->maxy + dy) - MAX(box->miny, tbox->miny + dy) + 1;
+                if ((ovx > 0) && (ovy > 0) && (ovx * ovy > best)) {
+                    best = ovx * ovy;
+                    best_obj = indx;
+                    best_trk = trk;
+                }
             }
         }
-
-        img[y * width] = img[y * width + width - 1] = flag;
+        if (best_obj == -1) {
+            break;
+        }
+        obj_trk[best_obj] = best_trk;
+        trk_used[best_trk] = true;
     }
-    return sum;
 }
 
-/* Erodes in a + shape. */
-int cls_alg::erode5(u_char *img, int width, int height, void *buffer, u_char flag)
+/*
+ * Follow the objects from image to image.  The objects are the largest
+ * labels of the labeling so the despeckle_filter must end with l.  A
+ * tracked object that is not seen is kept for the event_gap (at least a
+ * second) so that it keeps its id when it stops and starts again.
+ */
+void cls_alg::track()
 {
-    int y, i, sum = 0;
-    char *Row1, *Row2, *Row3;
+    ctx_image_data *img = cam->current_image;
+    ctx_object obj[OBJECT_MAX];
+    ctx_alg_track *trk;
+    int obj_trk[OBJECT_MAX];
+    int indx, obj_cnt, rate, keep, frames, vx, vy;
+
+    img->object_cnt = 0;
+    track_on = (cam->cfg->track_objects && despeckle_label);
+    if (track_on == false) {
+        return;
+    }
 
-    Row1 = (char *)buffer;
-    Row2 = Row1 + width;
-    Row3 = Row1 + 2 * width;
-    memset(Row2, flag, (uint)width);
-    memcpy(Row3, img, (uint)width);
+    rate = MAX(cam->lastrate, 1);
+    keep = MAX(cam->cfg->event_gap, 1) * rate;
 
-    for (y = 0; y < height; y++) {
-        memcpy(Row1, Row2, (uint)width);
-        memcpy(Row2, Row3, (uint)width);
+    obj_cnt = track_objects(obj);
+    track_match(obj, obj_cnt, obj_trk);
 
-        if (y == height - 1) {
-            memset(Row3, flag, (uint)width);
-        } else {
-            memcpy(Row3, img + (y + 1) * width, (uint)width);
-        }
+    for (indx = 0; indx < track_cnt; indx++) {
+        track_list[indx].missed++;
+    }
 
-        for (i = width - 2; i >= 1; i--) {
-            if (Row1[i]     == 0 ||
-                Row2[i - 1] == 0 ||
-                Row2[i]     == 0 ||
-                Row2[i + 1] == 0 ||
-                Row3[i]     == 0) {
-                img[y * width + i] = 0;
-            } else {
-                sum++;
+    for (indx = 0; indx < obj_cnt; indx++) {
+        if (obj_trk[indx] != -1) {
+            trk = &track_list[obj_trk[indx]];
+            frames = trk->missed;
+            vx = (obj[indx].box.x - trk->obj.box.x) * rate / frames;
+            vy = (obj[indx].box.y - trk->obj.box.y) * rate / frames;
+            if (trk->frames > 1) {
+                vx = (vx + trk->obj.vx) / 2;
+                vy = (vy + trk->obj.vy) / 2;
             }
+            obj[indx].id = trk->obj.id;
+            obj[indx].vx = vx;
+            obj[indx].vy = vy;
+            trk->frames++;
+        } else if (track_cnt < OBJECT_MAX) {
+            trk = &track_list[track_cnt++];
+            obj[indx].id = ++track_id;
+            trk->frames = 1;
+            trk->event = false;
+        } else {
+            continue;
+        }
+        trk->obj = obj[indx];
+        trk->missed = 0;
+        if (cam->detecting_motion) {
+            trk->event = true;
         }
+        img->objects[img->object_cnt++] = obj[indx];
+    }
 
-        img[y * width] = img[y * width + width - 1] = flag;
+    /* Drop the objects that have not been seen for too long */
+    for (indx = 0; indx < track_cnt; ) {
+        if (track_list[indx].missed > keep) {
+            track_list[indx] = track_list[--track_cnt];
+        } else {
+            indx++;
+        }
     }
-    return sum;
 }
 
-void cls_alg::despeckle()
+/*
+ * Whether the motion of the image only comes from slow objects that were
+ * already seen during an earlier event.  These are not to start a new event.
+ */
+bool cls_alg::track_slow()
 {
-    int diffs, width, height, done;
-    uint i, len;
-    u_char *out, *common_buffer;
+    ctx_alg_track *trk;
+    int indx, speed, cnt;
 
-    if ((cam->cfg->despeckle_filter == "") || cam->current_image->diffs <= 0) {
-        if (cam->imgs.labelsize_max) {
-            cam->imgs.labelsize_max = 0;
-        }
-        return;
+    if ((track_on == false) ||
+        (cam->cfg->track_slow_speed == 0) ||
+        (cam->detecting_motion)) {
+        return false;
     }
 
-    diffs = 0;
-    out = cam->imgs.image_motion.image_norm;
-    width = cam->imgs.width;
-    height = cam->imgs.height;
-    done = 0;
-    len = (uint)cam->cfg->despeckle_filter.length();
-    common_buffer = cam->imgs.common_buffer;
-    cam->current_image->total_labels = 0;
-    cam->imgs.largest_label = 0;
-
-    for (i = 0; i < len; i++) {
-        switch (cam->cfg->despeckle_filter[i]) {
-        case 'E':
-            diffs = erode9(out, width, height, common_buffer, 0);
-            if (diffs == 0) {
-                i = len;
-            }
-            done = 1;
-            break;
-        case 'e':
-            diffs = erode5(out, width, height, common_buffer, 0);
-            if (diffs == 0) {
-                i = len;
-            }
-            done = 1;
-            break;
-        case 'D':
-            diffs = dilate9(out, width, height, common_buffer);
-            done = 1;
-            break;
-        case 'd':
-            diffs = dilate5(out, width, height, common_buffer);
-            done = 1;
-            break;
-        /* No further despeckle after labeling! */
-        case 'l':
-            diffs = labeling();
-            i = len;
-            done = 2;
-            break;
+    cnt = 0;
+    for (indx = 0; indx < track_cnt; indx++) {
+        trk = &track_list[indx];
+        if (trk->missed != 0) {
+            continue;
         }
-    }
-
-    /* If conf.despeckle_filter contains any valid action EeDdl */
-    if (done) {
-        if (done != 2) {
-            cam->imgs.labelsize_max = 0; // Disable Labeling
+        speed = MAX(abs(trk->obj.vx), abs(trk->obj.vy));
+        if ((trk->event == false) || (speed >= cam->cfg->track_slow_speed)) {
+            return false;
         }
-        cam->current_image->diffs = diffs;
-        return;
-    } else {
-        cam->imgs.labelsize_max = 0; // Disable Labeling
+        cnt++;
     }
 
-    return;
+    return (cnt > 0);
 }
 
-void cls_alg::tune_smartmask()
+
+/*
+ * Row kernels for the erode and dilate.  The 3x3 box and the + shape are
+ * both built from the minimum (erode) or maximum (dilate) of three rows.
+ * The box is the vertical result of three rows followed by the horizontal
+ * result of three neighbouring columns.  The + shape is the vertical result
+ * combined with the left and right neighbours in the center row.
+ */
+static void alg_row_min3(u_char *dst, const u_char *a, const u_char *b, const u_char *c, int cnt)
 {
-    int i;
-    u_char diff;
-    int motionsize = cam->imgs.motionsize;
-    int sensitivity = cam->lastrate * (11 - cam->cfg->smart_mask_speed);
+    int indx = 0;
+
+    #if defined(HAVE_ALG_SSE2)
+        __m128i va, vb, vc;
+        for (; indx + 16 <= cnt; indx += 16) {
+            va = _mm_loadu_si128((const __m128i *)(a + indx));
+            vb = _mm_loadu_si128((const __m128i *)(b + indx));
+            vc = _mm_loadu_si128((const __m128i *)(c + indx));
+            _mm_storeu_si128((__m128i *)(dst + indx), _mm_min_epu8(_mm_min_epu8(va, vb), vc));
+        }
+    #elif defined(HAVE_ALG_NEON)
+        for (; indx + 16 <= cnt; indx += 16) {
+            vst1q_u8(dst + indx, vminq_u8(vminq_u8(vld1q_u8(a + indx)
+                , vld1q_u8(b + indx)), vld1q_u8(c + indx)));
+        }
+    #endif
 
-    if ((cam->cfg->smart_mask_speed == 0) ||
-        (cam->event_curr_nbr == cam->event_prev_nbr) ||
-        (--smartmask_count)) {
-        return;
+    for (; indx < cnt; indx++) {
+        dst[indx] = MIN(MIN(a[indx], b[indx]), c[indx]);
     }
+}
 
-    for (i = 0; i < motionsize; i++) {
-        /* Decrease smart_mask sensitivity every 5*speed seconds only. */
-        if (smartmask[i] > 0) {
-            smartmask[i]--;
-        }
-        /* Increase smart_mask sensitivity based on the buffered values. */
-        diff = (u_char)(smartmask_buffer[i] / sensitivity);
-
-        if (diff) {
-            if (smartmask[i] <= diff + 80) {
-                smartmask[i] += diff;
-            } else {
-                smartmask[i] = 80;
-            }
-            smartmask_buffer[i] %= sensitivity;
+static void alg_row_max3(u_char *dst, const u_char *a, const u_char *b, const u_char *c, int cnt)
+{
+    int indx = 0;
+
+    #if defined(HAVE_ALG_SSE2)
+        __m128i va, vb, vc;
+        for (; indx + 16 <= cnt; indx += 16) {
+            va = _mm_loadu_si128((const __m128i *)(a + indx));
+            vb = _mm_loadu_si128((const __m128i *)(b + indx));
+            vc = _mm_loadu_si128((const __m128i *)(c + indx));
+            _mm_storeu_si128((__m128i *)(dst + indx), _mm_max_epu8(_mm_max_epu8(va, vb), vc));
         }
-        /* Transfer raw mask to the final stage when above trigger value. */
-        if (smartmask[i] > 20) {
-            smartmask_final[i] = 0;
-        } else {
-            smartmask_final[i] = 255;
+    #elif defined(HAVE_ALG_NEON)
+        for (; indx + 16 <= cnt; indx += 16) {
+            vst1q_u8(dst + indx, vmaxq_u8(vmaxq_u8(vld1q_u8(a + indx)
+                , vld1q_u8(b + indx)), vld1q_u8(c + indx)));
         }
+    #endif
+
+    for (; indx < cnt; indx++) {
+        dst[indx] = MAX3(a[indx], b[indx], c[indx]);
     }
-    /* Further expansion (here:erode due to inverted logic!) of the mask. */
-    erode9(smartmask_final, cam->imgs.width, cam->imgs.height,
-                      cam->imgs.common_buffer, 255);
-    erode5(smartmask_final, cam->imgs.width, cam->imgs.height,
-                      cam->imgs.common_buffer, 255);
-    smartmask_count = 5 * cam->lastrate * (11 - cam->cfg->smart_mask_speed);
 }
 
-void cls_alg::diff_nomask()
+/*
+ * The erode keeps the original value of the pixel when none of the pixels
+ * in the shape are zero.  Returns the count of the pixels that are kept.
+ */
+static int alg_row_erode(u_char *dst, const u_char *ctr, int cnt)
 {
-    u_char *ref = cam->imgs.ref;
-    u_char *out = cam->imgs.image_motion.image_norm;
-    u_char *new_img = cam->imgs.image_vprvcy;
-
-    int i, curdiff;
-    int imgsz = cam->imgs.motionsize;
-    int diffs = 0;
-    int noise = cam->noise;
-
-    memset(out + imgsz, 128, (uint)(imgsz / 2));
-    memset(out, 0, (uint)imgsz);
+    int indx = 0, sum = 0;
+
+    #if defined(HAVE_ALG_SSE2)
+        __m128i zero = _mm_setzero_si128();
+        __m128i vz;
+        for (; indx + 16 <= cnt; indx += 16) {
+            vz = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(dst + indx)), zero);
+            _mm_storeu_si128((__m128i *)(dst + indx)
+                , _mm_andnot_si128(vz, _mm_loadu_si128((const __m128i *)(ctr + indx))));
+            sum += 16 - __builtin_popcount((uint)_mm_movemask_epi8(vz));
+        }
+    #elif defined(HAVE_ALG_NEON)
+        uint8x16_t vnz;
+        for (; indx + 16 <= cnt; indx += 16) {
+            vnz = vtstq_u8(vld1q_u8(dst + indx), vld1q_u8(dst + indx));
+            vst1q_u8(dst + indx, vandq_u8(vnz, vld1q_u8(ctr + indx)));
+            sum += vaddvq_u8(vshrq_n_u8(vnz, 7));
+        }
+    #endif
 
-    for (i = 0; i < imgsz; i++) {
-        curdiff = (*ref - *new_img);
-        if (abs(curdiff) > noise) {
-            *out = *new_img;
-            diffs++;
+    for (; indx < cnt; indx++) {
+        if (dst[indx] == 0) {
+            continue;
         }
-        out++;
-        ref++;
-        new_img++;
+        dst[indx] = ctr[indx];
+        sum++;
     }
-    cam->current_image->diffs_raw = diffs;
-    cam->current_image->diffs = diffs;
-    cam->imgs.image_motion.imgts = cam->current_image->imgts;
 
+    return sum;
 }
 
-void cls_alg::diff_mask()
+/* Count of the pixels that are not zero */
+static int alg_row_count(const u_char *dst, int cnt)
 {
-    u_char *ref  = cam->imgs.ref;
-    u_char *out  = cam->imgs.image_motion.image_norm;
-    u_char *mask = cam->imgs.mask;
-    u_char *new_img = cam->imgs.image_vprvcy;
-
-    int i, curdiff;
-    int imgsz = cam->imgs.motionsize;
-    int diffs = 0;
-    int noise = cam->noise;
-
-    memset(out + imgsz, 128, (uint)(imgsz / 2));
-    memset(out, 0, (uint)imgsz);
+    int indx = 0, sum = 0;
 
-    for (i = 0; i < imgsz; i++) {
-        curdiff = (*ref - *new_img);
-        if (mask) {
-            curdiff = ((curdiff * *mask) / 255);
+    #if defined(HAVE_ALG_SSE2)
+        __m128i zero = _mm_setzero_si128();
+        for (; indx + 16 <= cnt; indx += 16) {
+            sum += 16 - __builtin_popcount((uint)_mm_movemask_epi8(
+                _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(dst + indx)), zero)));
         }
-
-        if (abs(curdiff) > noise) {
-            *out = *new_img;
-            diffs++;
+    #elif defined(HAVE_ALG_NEON)
+        uint8x16_t vd;
+        for (; indx + 16 <= cnt; indx += 16) {
+            vd = vld1q_u8(dst + indx);
+            sum += vaddvq_u8(vshrq_n_u8(vtstq_u8(vd, vd), 7));
         }
+    #endif
 
-        out++;
-        ref++;
-        new_img++;
-        mask++;
+    for (; indx < cnt; indx++) {
+        if (dst[indx] != 0) {
+            sum++;
+        }
     }
-    cam->current_image->diffs_raw = diffs;
-    cam->current_image->diffs = diffs;
-    cam->imgs.image_motion.imgts = cam->current_image->imgts;
 
+    return sum;
 }
 
-void cls_alg::diff_smart()
+/* Whether any of the cnt pixels is not zero.  cnt is a multiple of 8. */
+static bool alg_span_any(const u_char *img, int cnt)
 {
+    int indx;
+    uint64_t acc, val;
 
-    u_char *ref  = cam->imgs.ref;
-    u_char *out  = cam->imgs.image_motion.image_norm;
-    u_char *mask_final = smartmask_final;
-    u_char *new_img = cam->imgs.image_vprvcy;
+    acc = 0;
+    for (indx = 0; indx < cnt; indx += 8) {
+        memcpy(&val, img + indx, sizeof(val));
+        acc |= val;
+    }
+    return (acc != 0);
+}
 
-    int i, curdiff;
-    int imgsz = cam->imgs.motionsize;
-    int diffs = 0;
-    int noise = cam->noise;
-    int *mask_buffer = smartmask_buffer;
-
-    imgsz = cam->imgs.motionsize;
-    memset(out + imgsz, 128, (uint)(imgsz / 2));
-    memset(out, 0, (uint)imgsz);
-
-    for (i = 0; i < imgsz; i++) {
-        curdiff = (*ref - *new_img);
-        if (cam->cfg->smart_mask_speed) {
-            if (abs(curdiff) > noise) {
-                if (cam->event_curr_nbr != cam->event_prev_nbr) {
-                    (*mask_buffer) += SMARTMASK_SENSITIVITY_INCR;
-                }
-                if (!*mask_final) {
-                    curdiff = 0;
-                }
+/*
+ * Set the dirty flags for the row of tiles starting at row y of the image
+ * and return the count of dirty tiles.
+ */
+int cls_alg::tile_mark(u_char *img, u_char *map, int y)
+{
+    int tx, row, x_beg, x_end, y_end, cnt;
+    int width = cam->imgs.width;
+    u_char *row_map = map + ((y / TILE_SIZE) * cam->imgs.tile_cols);
+
+    y_end = MIN(y + TILE_SIZE, cam->imgs.height);
+    cnt = 0;
+    for (tx = 0; tx < cam->imgs.tile_cols; tx++) {
+        x_beg = tx * TILE_SIZE;
+        x_end = MIN(x_beg + TILE_SIZE, width);
+        row_map[tx] = 0;
+        for (row = y; row < y_end; row++) {
+            if (alg_span_any(img + (row * width) + x_beg, x_end - x_beg)) {
+                row_map[tx] = 1;
+                cnt++;
+                break;
             }
-            mask_final++;
-            mask_buffer++;
-        }
-        /* Pixel still in motion after all the masks? */
-        if (abs(curdiff) > noise) {
-            *out = *new_img;
-            diffs++;
         }
-        out++;
-        ref++;
-        new_img++;
     }
-    cam->current_image->diffs_raw = diffs;
-    cam->current_image->diffs = diffs;
-    cam->imgs.image_motion.imgts = cam->current_image->imgts;
-
+    return cnt;
 }
 
-void cls_alg::diff_masksmart()
+/*
+ * Erode or dilate columns x_beg to x_end of row y from pool_img into
+ * pool_dst.  The rows above and below the image are the flag value for the
+ * erode and zero for the dilate.  The first and last columns of the image
+ * are set to the same values.  Returns the count of pixels that are not zero.
+ */
+int cls_alg::morph_span(u_char *vert, int y, int x_beg, int x_end)
 {
-    u_char *ref = cam->imgs.ref;
-    u_char *out = cam->imgs.image_motion.image_norm;
-    u_char *mask = cam->imgs.mask;
-    u_char *mask_final = smartmask_final;
-    u_char *new_img = cam->imgs.image_vprvcy;
+    int cnt, sum;
+    int width = cam->imgs.width;
+    int height = cam->imgs.height;
+    u_char *src = pool_img;
+    u_char *edge, *row0, *row1, *row2, *dst;
+    u_char edge_val;
 
-    int i, curdiff;
-    int imgsz = cam->imgs.motionsize;
-    int diffs = 0;
-    int noise = cam->noise;
-    int *mask_buffer = smartmask_buffer;
+    if ((pool_job == ALG_JOB_ERODE9) || (pool_job == ALG_JOB_ERODE5)) {
+        edge = morph_edge + width;
+        edge_val = pool_flag;
+    } else {
+        edge = morph_edge;
+        edge_val = 0;
+    }
 
-    imgsz= cam->imgs.motionsize;
-    memset(out + imgsz, 128, ((uint)imgsz / 2));
-    memset(out, 0, (uint)imgsz);
+    row0 = (y == 0) ? edge : src + ((y - 1) * width);
+    row1 = src + (y * width);
+    row2 = (y == height - 1) ? edge : src + ((y + 1) * width);
+    dst = pool_dst + (y * width);
 
-    for (i = 0; i < imgsz; i++) {
-        curdiff = (*ref - *new_img);
-        if (mask) {
-            curdiff = ((curdiff * *mask) / 255);
+    if (x_beg == 0) {
+        dst[0] = edge_val;
+        x_beg = 1;
+    }
+    if (x_end == width) {
+        dst[width - 1] = edge_val;
+        x_end = width - 1;
+    }
+    cnt = x_end - x_beg;
+    if (cnt <= 0) {
+        return 0;
+    }
+
+    /* The vertical results start one column to the left of x_beg */
+    row0 += x_beg - 1;
+    row1 += x_beg - 1;
+    row2 += x_beg - 1;
+    dst += x_beg;
+
+    if (pool_job == ALG_JOB_ERODE9) {
+        alg_row_min3(vert, row0, row1, row2, cnt + 2);
+        alg_row_min3(dst, vert, vert + 1, vert + 2, cnt);
+        sum = alg_row_erode(dst, row1 + 1, cnt);
+    } else if (pool_job == ALG_JOB_ERODE5) {
+        alg_row_min3(vert, row0, row1, row2, cnt + 2);
+        alg_row_min3(dst, vert + 1, row1, row1 + 2, cnt);
+        sum = alg_row_erode(dst, row1 + 1, cnt);
+    } else if (pool_job == ALG_JOB_DILATE9) {
+        alg_row_max3(vert, row0, row1, row2, cnt + 2);
+        alg_row_max3(dst, vert, vert + 1, vert + 2, cnt);
+        sum = alg_row_count(dst, cnt);
+    } else {
+        alg_row_max3(vert, row0, row1, row2, cnt + 2);
+        alg_row_max3(dst, vert + 1, row1, row1 + 2, cnt);
+        sum = alg_row_count(dst, cnt);
+    }
+
+    return sum;
+}
+
+/*
+ * Whether the tile of the destination can have any motion pixels.  The
+ * erode only keeps existing pixels while the dilate can spread one pixel
+ * into the neighbouring tiles.
+ */
+bool cls_alg::morph_tile_active(int tx, int ty)
+{
+    int cols = cam->imgs.tile_cols;
+    int rows = cam->imgs.tile_rows;
+    int x, y;
+
+    if ((pool_job == ALG_JOB_ERODE9) || (pool_job == ALG_JOB_ERODE5)) {
+        return (pool_map_src[(ty * cols) + tx] != 0);
+    }
+    for (y = MAX(ty - 1, 0); y <= MIN(ty + 1, rows - 1); y++) {
+        for (x = MAX(tx - 1, 0); x <= MIN(tx + 1, cols - 1); x++) {
+            if (pool_map_src[(y * cols) + x] != 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/*
+ * Erode or dilate the rows of the band.  When tile maps are given, only the
+ * tiles that can have motion pixels are processed.  The other tiles are
+ * cleared if the destination map shows they had pixels from before.
+ */
+int cls_alg::morph_band(ctx_alg_band *band)
+{
+    int tx, ty, y, row, y_end, x_beg, x_end, cnt, sum;
+    int width = cam->imgs.width;
+    int cols = cam->imgs.tile_cols;
+
+    sum = 0;
+    if (pool_map_src == NULL) {
+        for (y = band->row_beg; y < band->row_end; y++) {
+            sum += morph_span(band->buffer, y, 0, width);
         }
+        return sum;
+    }
 
-        if (cam->cfg->smart_mask_speed) {
-            if (abs(curdiff) > noise) {
-                if (cam->event_curr_nbr != cam->event_prev_nbr) {
-                    (*mask_buffer) += SMARTMASK_SENSITIVITY_INCR;
+    band->tiles = 0;
+    for (y = band->row_beg; y < band->row_end; y += TILE_SIZE) {
+        ty = y / TILE_SIZE;
+        y_end = MIN(y + TILE_SIZE, band->row_end);
+        for (tx = 0; tx < cols; tx++) {
+            x_beg = tx * TILE_SIZE;
+            x_end = MIN(x_beg + TILE_SIZE, width);
+            if (morph_tile_active(tx, ty)) {
+                cnt = 0;
+                for (row = y; row < y_end; row++) {
+                    cnt += morph_span(band->buffer, row, x_beg, x_end);
                 }
-                if (!*mask_final) {
-                    curdiff = 0;
+                pool_map_dst[(ty * cols) + tx] = (cnt > 0) ? 1 : 0;
+                sum += cnt;
+            } else if (pool_map_dst[(ty * cols) + tx] != 0) {
+                for (row = y; row < y_end; row++) {
+                    memset(pool_dst + (row * width) + x_beg, 0, (uint)(x_end - x_beg));
                 }
+                pool_map_dst[(ty * cols) + tx] = 0;
             }
-            mask_final++;
-            mask_buffer++;
+            band->tiles += pool_map_dst[(ty * cols) + tx];
         }
+    }
 
-        /* Pixel still in motion after all the masks? */
-        if (abs(curdiff) > noise) {
-            *out = *new_img;
-            diffs++;
+    return sum;
+}
+
+/*
+ * Run one of the erode or dilate operations across the bands.  Every band
+ * reads from img and writes to dst so the bands do not depend on each other.
+ */
+int cls_alg::morph_run(enum ALG_JOB job, u_char *img, u_char *dst, u_char flag)
+{
+    int indx, sum;
+
+    memset(morph_edge + cam->imgs.width, flag, (uint)cam->imgs.width);
+
+    pool_img = img;
+    pool_dst = dst;
+    pool_flag = flag;
+    pool_map_src = NULL;
+    pool_map_dst = NULL;
+    pool_run(job);
+
+    sum = 0;
+    for (indx = 0; indx < band_cnt; indx++) {
+        sum += bands[indx].sum;
+    }
+
+    return sum;
+}
+
+/*
+ * Erode or dilate only the tiles of the image that can have motion.  The
+ * maps hold the dirty tiles of img and dst and the dst map is updated.
+ * The edges outside of the image are zero.
+ */
+int cls_alg::morph_run_tiles(enum ALG_JOB job, u_char *img, u_char *dst
+    , u_char *map_img, u_char *map_dst)
+{
+    int indx, sum;
+
+    memset(morph_edge + cam->imgs.width, 0, (uint)cam->imgs.width);
+
+    pool_img = img;
+    pool_dst = dst;
+    pool_flag = 0;
+    pool_map_src = map_img;
+    pool_map_dst = map_dst;
+    pool_run(job);
+
+    sum = 0;
+    for (indx = 0; indx < band_cnt; indx++) {
+        sum += bands[indx].sum;
+    }
+
+    return sum;
+}
+
+/* Copy the dirty tiles of the morph buffer back to the motion image */
+void cls_alg::morph_copy_back()
+{
+    int tx, ty, y, x_beg, x_end, y_end, indx, tiles;
+    int width = cam->imgs.width;
+    int cols = cam->imgs.tile_cols;
+    u_char *out = cam->imgs.image_motion.image_norm;
+    u_char *map_out = cam->imgs.tile_dirty;
+
+    tiles = 0;
+    for (ty = 0; ty < cam->imgs.tile_rows; ty++) {
+        y_end = MIN((ty + 1) * TILE_SIZE, cam->imgs.height);
+        for (tx = 0; tx < cols; tx++) {
+            indx = (ty * cols) + tx;
+            if ((morph_map[indx] == 0) && (map_out[indx] == 0)) {
+                continue;
+            }
+            x_beg = tx * TILE_SIZE;
+            x_end = MIN(x_beg + TILE_SIZE, width);
+            for (y = ty * TILE_SIZE; y < y_end; y++) {
+                if (morph_map[indx] != 0) {
+                    memcpy(out + (y * width) + x_beg
+                        , morph_buf + (y * width) + x_beg, (uint)(x_end - x_beg));
+                } else {
+                    memset(out + (y * width) + x_beg, 0, (uint)(x_end - x_beg));
+                }
+            }
+            map_out[indx] = morph_map[indx];
+            tiles += map_out[indx];
         }
+    }
+    /* Stored once since the webcontrol reads it */
+    cam->imgs.tile_dirty_cnt = tiles;
+}
 
-        out++;
-        ref++;
-        new_img++;
-        mask++;
+/*
+ * Translate the despeckle_filter into the list of erode and dilate steps
+ * and whether it ends with the labeling.
+ */
+void cls_alg::despeckle_init()
+{
+    uint indx;
+    std::string &filter = cam->cfg->despeckle_filter;
+
+    despeckle_plan.clear();
+    despeckle_label = false;
+
+    for (indx = 0; indx < filter.length(); indx++) {
+        if (filter[indx] == 'E') {
+            despeckle_plan.push_back(ALG_JOB_ERODE9);
+        } else if (filter[indx] == 'e') {
+            despeckle_plan.push_back(ALG_JOB_ERODE5);
+        } else if (filter[indx] == 'D') {
+            despeckle_plan.push_back(ALG_JOB_DILATE9);
+        } else if (filter[indx] == 'd') {
+            despeckle_plan.push_back(ALG_JOB_DILATE5);
+        } else if (filter[indx] == 'l') {
+            /* No further despeckle after labeling! */
+            despeckle_label = true;
+            break;
+        }
     }
 
-    cam->current_image->diffs_raw = diffs;
-    cam->current_image->diffs = diffs;
-    cam->imgs.image_motion.imgts = cam->current_image->imgts;
+    /* The objects are the labels so there is nothing to track without them */
+    if (cam->cfg->track_objects && (despeckle_label == false)) {
+        MOTION_LOG(WRN, TYPE_ALL, NO_ERRNO
+            ,_("track_objects requires the labeling (l) in despeckle_filter.  Tracking disabled."));
+    }
+}
+
+/*
+ * Each step writes to the other of the motion image and the morph buffer
+ * and the result is copied back to the motion image at the end.  Only the
+ * tiles with motion (and their neighbours for the dilate) are processed.
+ */
+void cls_alg::despeckle()
+{
+    int diffs, tiles, band;
+    uint indx;
+    u_char *out, *src, *dst, *map_src, *map_dst;
+
+    if ((cam->cfg->despeckle_filter == "") || cam->current_image->diffs <= 0) {
+        if (cam->imgs.labelsize_max) {
+            cam->imgs.labelsize_max = 0;
+        }
+        return;
+    }
 
+    diffs = 0;
+    out = cam->imgs.image_motion.image_norm;
+    cam->current_image->total_labels = 0;
+    cam->imgs.largest_label = 0;
+
+    src = out;
+    map_src = cam->imgs.tile_dirty;
+    for (indx = 0; indx < despeckle_plan.size(); indx++) {
+        dst = (src == out) ? morph_buf : out;
+        map_dst = (src == out) ? morph_map : cam->imgs.tile_dirty;
+        diffs = morph_run_tiles(despeckle_plan[indx], src, dst, map_src, map_dst);
+        src = dst;
+        map_src = map_dst;
+        if ((diffs == 0) &&
+            ((despeckle_plan[indx] == ALG_JOB_ERODE9) ||
+             (despeckle_plan[indx] == ALG_JOB_ERODE5))) {
+            break;
+        }
+    }
+    if (src != out) {
+        morph_copy_back();
+    } else if (despeckle_plan.size() > 0) {
+        tiles = 0;
+        for (band = 0; band < band_cnt; band++) {
+            tiles += bands[band].tiles;
+        }
+        cam->imgs.tile_dirty_cnt = tiles;
+    }
+
+    if (despeckle_label && (indx == despeckle_plan.size())) {
+        diffs = labeling();
+    } else {
+        cam->imgs.labelsize_max = 0; // Disable Labeling
+    }
+
+    /* If conf.despeckle_filter contains any valid action EeDdl */
+    if ((despeckle_plan.size() > 0) || despeckle_label) {
+        cam->current_image->diffs = diffs;
+    }
+}
+
+void cls_alg::tune_smartmask()
+{
+    int i;
+    u_char diff;
+    int motionsize = cam->imgs.motionsize;
+    int sensitivity = cam->lastrate * (11 - cam->cfg->smart_mask_speed);
+
+    if ((cam->cfg->smart_mask_speed == 0) ||
+        (cam->event_curr_nbr == cam->event_prev_nbr) ||
+        (--smartmask_count)) {
+        return;
+    }
+
+    for (i = 0; i < motionsize; i++) {
+        /* Decrease smart_mask sensitivity every 5*speed seconds only. */
+        if (smartmask[i] > 0) {
+            smartmask[i]--;
+        }
+        /* Increase smart_mask sensitivity based on the buffered values. */
+        diff = (u_char)(smartmask_buffer[i] / sensitivity);
+
+        if (diff) {
+            if (smartmask[i] <= diff + 80) {
+                smartmask[i] += diff;
+            } else {
+                smartmask[i] = 80;
+            }
+            smartmask_buffer[i] %= sensitivity;
+        }
+        /* Transfer raw mask to the final stage when above trigger value. */
+        if (smartmask[i] > 20) {
+            smartmask_final[i] = 0;
+        } else {
+            smartmask_final[i] = 255;
+        }
+    }
+    /* Further expansion (here:erode due to inverted logic!) of the mask. */
+    morph_run(ALG_JOB_ERODE9, smartmask_final, morph_buf, 255);
+    morph_run(ALG_JOB_ERODE5, morph_buf, smartmask_final, 255);
+    /* The morph buffer is no longer clear */
+    memset(morph_map, 1, (uint)(cam->imgs.tile_cols * cam->imgs.tile_rows));
+    smartmask_count = 5 * cam->lastrate * (11 - cam->cfg->smart_mask_speed);
+}
+
+int cls_alg::diff_nomask(int pix_beg, int pix_end)
+{
+    ctx_diff_vec dv;
+
+    dv = {cam->imgs.ref + pix_beg, cam->imgs.image_vprvcy + pix_beg
+        , cam->imgs.image_motion.image_norm + pix_beg
+        , NULL, NULL, NULL, pix_end - pix_beg, cam->noise, 0, false};
+
+    return alg_diff_scalar(&dv, alg_diff_vec(&dv, simd_avx2));
+}
+
+int cls_alg::diff_mask(int pix_beg, int pix_end)
+{
+    ctx_diff_vec dv;
+
+    dv = {cam->imgs.ref + pix_beg, cam->imgs.image_vprvcy + pix_beg
+        , cam->imgs.image_motion.image_norm + pix_beg
+        , cam->imgs.mask + pix_beg, NULL, NULL
+        , pix_end - pix_beg, cam->noise, 0, false};
+
+    return alg_diff_scalar(&dv, alg_diff_vec(&dv, simd_avx2));
+}
+
+int cls_alg::diff_smart(int pix_beg, int pix_end)
+{
+    ctx_diff_vec dv;
+
+    dv = {cam->imgs.ref + pix_beg, cam->imgs.image_vprvcy + pix_beg
+        , cam->imgs.image_motion.image_norm + pix_beg
+        , NULL, smartmask_final + pix_beg, smartmask_buffer + pix_beg
+        , pix_end - pix_beg, cam->noise, 0
+        , (cam->event_curr_nbr != cam->event_prev_nbr)};
+    if (cam->cfg->smart_mask_speed == 0) {
+        dv.mask_final = NULL;
+    }
+
+    return alg_diff_scalar(&dv, alg_diff_vec(&dv, simd_avx2));
+}
+
+int cls_alg::diff_masksmart(int pix_beg, int pix_end)
+{
+    ctx_diff_vec dv;
+
+    dv = {cam->imgs.ref + pix_beg, cam->imgs.image_vprvcy + pix_beg
+        , cam->imgs.image_motion.image_norm + pix_beg
+        , cam->imgs.mask + pix_beg, smartmask_final + pix_beg
+        , smartmask_buffer + pix_beg, pix_end - pix_beg, cam->noise, 0
+        , (cam->event_curr_nbr != cam->event_prev_nbr)};
+    if (cam->cfg->smart_mask_speed == 0) {
+        dv.mask_final = NULL;
+    }
+
+    return alg_diff_scalar(&dv, alg_diff_vec(&dv, simd_avx2));
 }
 
 bool cls_alg::diff_fast()
@@ -817,21 +1203,61 @@ bool cls_alg::diff_fast()
     return false;
 }
 
-void cls_alg::diff_standard()
+/*
+ * Diff the band a row of tiles at a time and mark the dirty tiles while
+ * the rows are still in cache.
+ */
+int cls_alg::diff_band(ctx_alg_band *band)
 {
-    if (cam->cfg->smart_mask_speed == 0) {
-        if (cam->imgs.mask == NULL) {
-            diff_nomask();
-        } else {
-            diff_mask();
-        }
-    } else {
-        if (cam->imgs.mask == NULL) {
-            diff_smart();
+    int y, pix_beg, pix_end, diffs;
+    int width = cam->imgs.width;
+
+    diffs = 0;
+    band->tiles = 0;
+    for (y = band->row_beg; y < band->row_end; y += TILE_SIZE) {
+        pix_beg = y * width;
+        pix_end = MIN(y + TILE_SIZE, band->row_end) * width;
+        if (cam->cfg->smart_mask_speed == 0) {
+            if (cam->imgs.mask == NULL) {
+                diffs += diff_nomask(pix_beg, pix_end);
+            } else {
+                diffs += diff_mask(pix_beg, pix_end);
+            }
         } else {
-            diff_masksmart();
+            if (cam->imgs.mask == NULL) {
+                diffs += diff_smart(pix_beg, pix_end);
+            } else {
+                diffs += diff_masksmart(pix_beg, pix_end);
+            }
         }
+        band->tiles += tile_mark(cam->imgs.image_motion.image_norm
+            , cam->imgs.tile_dirty, y);
     }
+
+    return diffs;
+}
+
+void cls_alg::diff_standard()
+{
+    int indx, diffs, tiles;
+    int imgsz = cam->imgs.motionsize;
+
+    memset(cam->imgs.image_motion.image_norm + imgsz, 128, (uint)(imgsz / 2));
+
+    pool_run(ALG_JOB_DIFF);
+
+    diffs = 0;
+    tiles = 0;
+    for (indx = 0; indx < band_cnt; indx++) {
+        diffs += bands[indx].sum;
+        tiles += bands[indx].tiles;
+    }
+    /* Stored once since the webcontrol reads it */
+    cam->imgs.tile_dirty_cnt = tiles;
+
+    cam->current_image->diffs_raw = diffs;
+    cam->current_image->diffs = diffs;
+    cam->imgs.image_motion.imgts = cam->current_image->imgts;
 }
 
 void cls_alg::lightswitch()
@@ -848,45 +1274,139 @@ void cls_alg::lightswitch()
     }
 }
 
-void cls_alg::ref_frame_update()
+/*
+ * Update of the reference frame and the static object counters for cnt
+ * pixels.  A pixel that differs from the reference and is not masked is
+ * held out of the reference while it keeps moving, for at most
+ * accept_timer frames, after which it is accepted as a static object.  A
+ * pixel that stops moving is averaged in and all other pixels are copied.
+ * The rule is written as masks so the vector versions handle 16 pixels
+ * per pass.  The counter never exceeds accept_timer + 1 so it fits the
+ * 16 bits as long as accept_timer is below 65535.
+ */
+static void alg_ref_update(u_char *ref, const u_char *virgin, const u_char *mask
+    , const u_char *out, uint16_t *dyn, int cnt, int threshold_ref, int accept_timer)
 {
-    int accept_timer;
-    int i, threshold_ref;
-    int *ref_dyn = cam->imgs.ref_dyn;
-    u_char *image_virgin = cam->imgs.image_vprvcy;
-    u_char *ref = cam->imgs.ref;
-    u_char *mask_final = smartmask_final;
-    u_char *out = cam->imgs.image_motion.image_norm;
-
-    accept_timer = cam->cfg->static_object_time * cam->cfg->framerate;
-    threshold_ref = cam->noise * EXCLUDE_LEVEL_PERCENT / 100;
-
-    for (i = cam->imgs.motionsize; i > 0; i--) {
-        /* Exclude pixels from ref frame well below noise level. */
-        if (((int)(abs(*ref - *image_virgin)) > threshold_ref) && (*mask_final)) {
-            if (*ref_dyn == 0) { /* Always give new pixels a chance. */
-                *ref_dyn = 1;
-            } else if (*ref_dyn > accept_timer) { /* Include static Object after some time. */
-                *ref_dyn = 0;
-                *ref = *image_virgin;
-            } else if (*out) {
-                (*ref_dyn)++; /* Motionpixel? Keep excluding from ref frame. */
-            } else {
-                *ref_dyn = 0; /* Nothing special - release pixel. */
-                *ref = (u_char)((*ref + *image_virgin) / 2);
+    int indx = 0;
+    bool chg, keep, avg;
+
+    #if defined(HAVE_ALG_SSE2)
+        __m128i zero = _mm_setzero_si128();
+        __m128i ones = _mm_set1_epi8(-1);
+        __m128i one8 = _mm_set1_epi8(1);
+        __m128i one16 = _mm_set1_epi16(1);
+        __m128i thr = _mm_set1_epi8((char)threshold_ref);
+        __m128i acc = _mm_set1_epi16((short)accept_timer);
+        __m128i vr, vv, vc, vo, vavg, vkeep, vbig, dlo, dhi, klo, khi, blo, bhi;
+        if ((threshold_ref >= 0) && (threshold_ref < 255)) {
+            for (; indx + 16 <= cnt; indx += 16) {
+                vr = _mm_loadu_si128((const __m128i *)(ref + indx));
+                vv = _mm_loadu_si128((const __m128i *)(virgin + indx));
+                vc = _mm_or_si128(_mm_subs_epu8(vr, vv), _mm_subs_epu8(vv, vr));
+                vc = _mm_or_si128(_mm_cmpeq_epi8(_mm_subs_epu8(vc, thr), zero)
+                    , _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(mask + indx)), zero));
+                vc = _mm_xor_si128(vc, ones);
+                vo = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(out + indx)), zero);
+
+                dlo = _mm_loadu_si128((const __m128i *)(dyn + indx));
+                dhi = _mm_loadu_si128((const __m128i *)(dyn + indx + 8));
+                blo = _mm_xor_si128(_mm_cmpeq_epi16(_mm_subs_epu16(dlo, acc), zero), ones);
+                bhi = _mm_xor_si128(_mm_cmpeq_epi16(_mm_subs_epu16(dhi, acc), zero), ones);
+                vbig = _mm_packs_epi16(blo, bhi);
+
+                /* Held out when new, or when still moving and not yet accepted */
+                klo = _mm_or_si128(_mm_cmpeq_epi16(dlo, zero)
+                    , _mm_andnot_si128(_mm_or_si128(blo, _mm_unpacklo_epi8(vo, vo))
+                    , ones));
+                khi = _mm_or_si128(_mm_cmpeq_epi16(dhi, zero)
+                    , _mm_andnot_si128(_mm_or_si128(bhi, _mm_unpackhi_epi8(vo, vo))
+                    , ones));
+                klo = _mm_and_si128(klo, _mm_unpacklo_epi8(vc, vc));
+                khi = _mm_and_si128(khi, _mm_unpackhi_epi8(vc, vc));
+                _mm_storeu_si128((__m128i *)(dyn + indx)
+                    , _mm_and_si128(_mm_add_epi16(dlo, one16), klo));
+                _mm_storeu_si128((__m128i *)(dyn + indx + 8)
+                    , _mm_and_si128(_mm_add_epi16(dhi, one16), khi));
+                vkeep = _mm_packs_epi16(klo, khi);
+
+                /* Averaged when stopped before being accepted, otherwise copied */
+                vavg = _mm_andnot_si128(_mm_or_si128(vkeep, vbig), vc);
+                vv = _mm_or_si128(_mm_and_si128(vavg, _mm_sub_epi8(_mm_avg_epu8(vr, vv)
+                    , _mm_and_si128(_mm_xor_si128(vr, vv), one8)))
+                    , _mm_andnot_si128(_mm_or_si128(vkeep, vavg), vv));
+                _mm_storeu_si128((__m128i *)(ref + indx)
+                    , _mm_or_si128(_mm_and_si128(vkeep, vr), vv));
             }
-        } else {  /* No motion: copy to ref frame. */
-            *ref_dyn = 0; /* Reset pixel */
-            *ref = *image_virgin;
         }
-
-        ref++;
-        image_virgin++;
-        mask_final++;
-        ref_dyn++;
-        out++;
+    #elif defined(HAVE_ALG_NEON)
+        uint8x16_t vthr = vdupq_n_u8((uint8_t)threshold_ref);
+        uint16x8_t vacc = vdupq_n_u16((uint16_t)accept_timer);
+        uint16x8_t one16 = vdupq_n_u16(1);
+        uint8x16_t vr, vv, vc, vo, vkeep, vbig, vavg;
+        uint16x8_t dlo, dhi, klo, khi, blo, bhi;
+        if ((threshold_ref >= 0) && (threshold_ref < 255)) {
+            for (; indx + 16 <= cnt; indx += 16) {
+                vr = vld1q_u8(ref + indx);
+                vv = vld1q_u8(virgin + indx);
+                vc = vandq_u8(vcgtq_u8(vabdq_u8(vr, vv), vthr)
+                    , vtstq_u8(vld1q_u8(mask + indx), vld1q_u8(mask + indx)));
+                vo = vtstq_u8(vld1q_u8(out + indx), vld1q_u8(out + indx));
+
+                dlo = vld1q_u16(dyn + indx);
+                dhi = vld1q_u16(dyn + indx + 8);
+                blo = vcgtq_u16(dlo, vacc);
+                bhi = vcgtq_u16(dhi, vacc);
+                vbig = vcombine_u8(vmovn_u16(blo), vmovn_u16(bhi));
+
+                /* Held out when new, or when still moving and not yet accepted */
+                vkeep = vandq_u8(vc, vorrq_u8(vcombine_u8(vmovn_u16(vceqq_u16(dlo, vdupq_n_u16(0)))
+                    , vmovn_u16(vceqq_u16(dhi, vdupq_n_u16(0)))), vbicq_u8(vo, vbig)));
+                klo = vreinterpretq_u16_s16(vmovl_s8(vreinterpret_s8_u8(vget_low_u8(vkeep))));
+                khi = vreinterpretq_u16_s16(vmovl_s8(vreinterpret_s8_u8(vget_high_u8(vkeep))));
+                vst1q_u16(dyn + indx, vandq_u16(vaddq_u16(dlo, one16), klo));
+                vst1q_u16(dyn + indx + 8, vandq_u16(vaddq_u16(dhi, one16), khi));
+
+                /* Averaged when stopped before being accepted, otherwise copied */
+                vavg = vbicq_u8(vc, vorrq_u8(vkeep, vbig));
+                vst1q_u8(ref + indx, vbslq_u8(vkeep, vr
+                    , vbslq_u8(vavg, vhaddq_u8(vr, vv), vv)));
+            }
+        }
+    #endif
+
+    for (; indx < cnt; indx++) {
+        chg = (abs(ref[indx] - virgin[indx]) > threshold_ref) & (mask[indx] != 0);
+        keep = chg & ((dyn[indx] == 0) | ((dyn[indx] <= accept_timer) & (out[indx] != 0)));
+        avg = chg & !keep & (dyn[indx] <= accept_timer);
+        dyn[indx] = keep ? (uint16_t)(dyn[indx] + 1) : 0;
+        ref[indx] = keep ? ref[indx] :
+            (avg ? (u_char)((ref[indx] + virgin[indx]) / 2) : virgin[indx]);
     }
+}
+
+void cls_alg::ref_frame_update()
+{
+    pool_run(ALG_JOB_REFUPD);
+}
+
+void cls_alg::ref_update_band(ctx_alg_band *band)
+{
+    int pix_beg = band->row_beg * cam->imgs.width;
 
+    alg_ref_update(cam->imgs.ref + pix_beg, cam->imgs.image_vprvcy + pix_beg
+        , smartmask_final + pix_beg, cam->imgs.image_motion.image_norm + pix_beg
+        , cam->imgs.ref_dyn + pix_beg
+        , (band->row_end - band->row_beg) * cam->imgs.width
+        , cam->noise * EXCLUDE_LEVEL_PERCENT / 100, ref_accept_timer());
+}
+
+/*
+ * Frames a changed pixel may be held out of the reference frame before it
+ * is accepted as a static object.  Limited to what the 16 bit counters hold.
+ */
+int cls_alg::ref_accept_timer()
+{
+    return MIN(cam->cfg->static_object_time * cam->cfg->framerate, 65534);
 }
 
 void cls_alg::ref_frame_reset()
@@ -899,139 +1419,234 @@ void cls_alg::ref_frame_reset()
 
 }
 
-/*Calculate the center location of changes*/
-void cls_alg::location_center()
+/* Ensure min/max are within limits*/
+void cls_alg::location_minmax()
 {
+
     int width = cam->imgs.width;
     int height = cam->imgs.height;
     ctx_coord *cent = &cam->current_image->location;
-    u_char *out = cam->imgs.image_motion.image_norm;
-    int x, y, centc = 0;
 
-    cent->x = 0;
-    cent->y = 0;
-
-    for (y = 0; y < height; y++) {
-        for (x = 0; x < width; x++) {
-            if (*(out++)) {
-                cent->x += x;
-                cent->y += y;
-                centc++;
-            }
-        }
+    if (cent->maxx > width - 1) {
+        cent->maxx = width - 1;
+    } else if (cent->maxx < 0) {
+        cent->maxx = 0;
     }
 
-    if (centc) {
-        cent->x = cent->x / centc;
-        cent->y = cent->y / centc;
+    if (cent->maxy > height - 1) {
+        cent->maxy = height - 1;
+    } else if (cent->maxy < 0) {
+        cent->maxy = 0;
     }
 
-    /* This allows for the redcross and boxes to be drawn*/
-    if (cent->x < 10) {
-        cent->x = 15;
+    if (cent->minx > width - 1) {
+        cent->minx = width - 1;
+    } else if (cent->minx < 0) {
+        cent->minx = 0;
     }
-    if (cent->y < 10) {
-        cent->y = 15;
+
+    if (cent->miny > height - 1) {
+        cent->miny = height - 1;
+    } else if (cent->miny < 0) {
+        cent->miny = 0;
     }
-    if ((cent->x + 10) > width) {
-        cent->x = width - 15;
+
+    /* Align for better locate box handling */
+    cent->minx += cent->minx % 2;
+    cent->miny += cent->miny % 2;
+    cent->maxx -= cent->maxx % 2;
+    cent->maxy -= cent->maxy % 2;
+
+    cent->width = cent->maxx - cent->minx;
+    cent->height = cent->maxy - cent->miny;
+    cent->y = (cent->miny + cent->maxy) / 2;
+}
+
+/*
+ * Single sweep version of the per pixel tuning stages.  The location sums
+ * and the reference frame update read the same planes so they are done
+ * together for each pixel.  The location is computed from the column and
+ * row counts of the motion pixels so the results are identical to running
+ * location and ref_frame_update in turn.  The noise tuning (once a second)
+ * changes the threshold used by the reference update so it is done first
+ * and when the smart mask is due to be rebuilt this frame, the staged path
+ * is used for everything.
+ */
+void cls_alg::tune_fused(bool do_noise, bool do_location)
+{
+    if (do_noise) {
+        noise_tune();
     }
-    if ((cent->y + 10) > height) {
-        cent->y = height - 15;
+
+    if ((cam->cfg->smart_mask_speed != 0) &&
+        (cam->event_curr_nbr != cam->event_prev_nbr) &&
+        (smartmask_count == 1)) {
+        if (do_location) {
+            location();
+        }
+        tune_smartmask();
+        ref_frame_update();
+        return;
     }
+    tune_smartmask();
+
+    pool_location = do_location;
+    pool_run(ALG_JOB_FUSED);
 
+    if (do_location) {
+        location_sum();
+        location_proj();
+        location_minmax();
+    }
 }
 
-void cls_alg::location_dist()
+void cls_alg::fused_band(ctx_alg_band *band)
 {
     ctx_images *imgs = &cam->imgs;
-    int width = cam->imgs.width;
-    int height = cam->imgs.height;
-    ctx_coord *cent = &cam->current_image->location;
+    int x, y, indx;
+    int width = imgs->width;
+    int accept_timer, threshold_ref;
+    int *colcnt = band->colcnt;
     u_char *out = imgs->image_motion.image_norm;
-    int x, y, centc = 0, xdist = 0, ydist = 0;
+    bool do_location = pool_location;
 
-    cent->maxx = 0;
-    cent->maxy = 0;
-    cent->minx = width;
-    cent->miny = height;
+    accept_timer = ref_accept_timer();
+    threshold_ref = cam->noise * EXCLUDE_LEVEL_PERCENT / 100;
 
-    for (y = 0; y < height; y++) {
-        for (x = 0; x < width; x++) {
-            if (*(out++)) {
-                if (x > cent->x) {
-                    xdist += x - cent->x;
-                } else if (x < cent->x) {
-                    xdist += cent->x - x;
-                }
+    if (do_location) {
+        memset(colcnt, 0, (uint)width * sizeof(*colcnt));
+        memset(loc_rowcnt + band->row_beg, 0
+            , (uint)(band->row_end - band->row_beg) * sizeof(*loc_rowcnt));
+    }
 
-                if (y > cent->y) {
-                    ydist += y - cent->y;
-                } else if (y < cent->y) {
-                    ydist += cent->y - y;
+    for (y = band->row_beg; y < band->row_end; y++) {
+        indx = y * width;
+        if (do_location) {
+            for (x = 0; x < width; x++) {
+                if (out[indx + x]) {
+                    colcnt[x]++;
+                    loc_rowcnt[y]++;
                 }
-
-                centc++;
             }
         }
+        alg_ref_update(imgs->ref + indx, imgs->image_vprvcy + indx
+            , smartmask_final + indx, out + indx, imgs->ref_dyn + indx
+            , width, threshold_ref, accept_timer);
     }
+}
 
-    if (centc) {
-        cent->minx = cent->x - xdist / centc * 3;
-        cent->maxx = cent->x + xdist / centc * 3;
-        cent->miny = cent->y - ydist / centc * 3;
-        cent->maxy = cent->y + ydist / centc * 3;
+/*
+ * Count the motion pixels of each column and row of the band.  Only the
+ * dirty tiles can hold motion pixels.
+ */
+void cls_alg::proj_band(ctx_alg_band *band)
+{
+    int x, y, span_beg, span_end, rowcnt;
+    int width = cam->imgs.width;
+    int *colcnt = band->colcnt;
+    u_char *out, *row_map;
+
+    memset(colcnt, 0, (uint)width * sizeof(*colcnt));
+    for (y = band->row_beg; y < band->row_end; y++) {
+        out = cam->imgs.image_motion.image_norm + (y * width);
+        row_map = cam->imgs.tile_dirty + ((y / TILE_SIZE) * cam->imgs.tile_cols);
+        rowcnt = 0;
+        span_end = 0;
+        while (tile_span(row_map, &span_beg, &span_end)) {
+            for (x = span_beg; x < span_end; x++) {
+                colcnt[x] += (out[x] != 0);
+                rowcnt += (out[x] != 0);
+            }
+        }
+        loc_rowcnt[y] = rowcnt;
     }
 }
 
-/* Ensure min/max are within limits*/
-void cls_alg::location_minmax()
+/* Add the column counts of the bands */
+void cls_alg::location_sum()
 {
+    int indx, x;
+    int width = cam->imgs.width;
+    int *colcnt;
 
+    memcpy(loc_colcnt, bands[0].colcnt, (uint)width * sizeof(*loc_colcnt));
+    for (indx = 1; indx < band_cnt; indx++) {
+        colcnt = bands[indx].colcnt;
+        for (x = 0; x < width; x++) {
+            loc_colcnt[x] += colcnt[x];
+        }
+    }
+}
+
+/* Center and spread of the motion from the column and row counts */
+void cls_alg::location_proj()
+{
     int width = cam->imgs.width;
     int height = cam->imgs.height;
     ctx_coord *cent = &cam->current_image->location;
-
-    if (cent->maxx > width - 1) {
-        cent->maxx = width - 1;
-    } else if (cent->maxx < 0) {
-        cent->maxx = 0;
+    int x, y;
+    int64_t centc, sumx, sumy, xdist, ydist;
+
+    centc = 0;
+    sumx = 0;
+    sumy = 0;
+    for (x = 0; x < width; x++) {
+        sumx += (int64_t)x * loc_colcnt[x];
+        centc += loc_colcnt[x];
+    }
+    for (y = 0; y < height; y++) {
+        sumy += (int64_t)y * loc_rowcnt[y];
     }
 
-    if (cent->maxy > height - 1) {
-        cent->maxy = height - 1;
-    } else if (cent->maxy < 0) {
-        cent->maxy = 0;
+    cent->x = 0;
+    cent->y = 0;
+    if (centc) {
+        cent->x = (int)(sumx / centc);
+        cent->y = (int)(sumy / centc);
     }
 
-    if (cent->minx > width - 1) {
-        cent->minx = width - 1;
-    } else if (cent->minx < 0) {
-        cent->minx = 0;
+    /* This allows for the redcross and boxes to be drawn*/
+    if (cent->x < 10) {
+        cent->x = 15;
+    }
+    if (cent->y < 10) {
+        cent->y = 15;
+    }
+    if ((cent->x + 10) > width) {
+        cent->x = width - 15;
+    }
+    if ((cent->y + 10) > height) {
+        cent->y = height - 15;
     }
 
-    if (cent->miny > height - 1) {
-        cent->miny = height - 1;
-    } else if (cent->miny < 0) {
-        cent->miny = 0;
+    xdist = 0;
+    ydist = 0;
+    for (x = 0; x < width; x++) {
+        xdist += (int64_t)ABS(x - cent->x) * loc_colcnt[x];
+    }
+    for (y = 0; y < height; y++) {
+        ydist += (int64_t)ABS(y - cent->y) * loc_rowcnt[y];
     }
 
-    /* Align for better locate box handling */
-    cent->minx += cent->minx % 2;
-    cent->miny += cent->miny % 2;
-    cent->maxx -= cent->maxx % 2;
-    cent->maxy -= cent->maxy % 2;
+    cent->maxx = 0;
+    cent->maxy = 0;
+    cent->minx = width;
+    cent->miny = height;
 
-    cent->width = cent->maxx - cent->minx;
-    cent->height = cent->maxy - cent->miny;
-    cent->y = (cent->miny + cent->maxy) / 2;
+    if (centc) {
+        cent->minx = cent->x - (int)(xdist / centc) * 3;
+        cent->maxx = cent->x + (int)(xdist / centc) * 3;
+        cent->miny = cent->y - (int)(ydist / centc) * 3;
+        cent->maxy = cent->y + (int)(ydist / centc) * 3;
+    }
 }
 
 /* Determine the location and standard deviations of changes*/
 void cls_alg::location()
 {
-    location_center();
-    location_dist();
+    pool_run(ALG_JOB_PROJ);
+    location_sum();
+    location_proj();
     location_minmax();
 }
 
@@ -1049,6 +1664,209 @@ void cls_alg::diff()
     }
     lightswitch();
     despeckle();
+    track();
+}
+
+static void *alg_pool_handler(void *arg)
+{
+    ((cls_alg *)arg)->pool_handler();
+    return nullptr;
+}
+
+/* Process the band with the job that is currently requested */
+void cls_alg::band_process(ctx_alg_band *band)
+{
+    if (pool_job == ALG_JOB_DIFF) {
+        band->sum = diff_band(band);
+    } else if ((pool_job == ALG_JOB_ERODE9) || (pool_job == ALG_JOB_ERODE5) ||
+        (pool_job == ALG_JOB_DILATE9) || (pool_job == ALG_JOB_DILATE5)) {
+        band->sum = morph_band(band);
+    } else if (pool_job == ALG_JOB_REFUPD) {
+        ref_update_band(band);
+    } else if (pool_job == ALG_JOB_FUSED) {
+        fused_band(band);
+    } else if (pool_job == ALG_JOB_PROJ) {
+        proj_band(band);
+    }
+}
+
+/* Take the next unprocessed band until none are left */
+void cls_alg::pool_work()
+{
+    int indx;
+
+    while (true) {
+        pthread_mutex_lock(&pool_mutex);
+            indx = band_next++;
+        pthread_mutex_unlock(&pool_mutex);
+        if (indx >= band_cnt) {
+            return;
+        }
+        band_process(&bands[indx]);
+    }
+}
+
+/* Worker thread processing loop */
+void cls_alg::pool_handler()
+{
+    int job_gen;
+
+    mythreadname_set("dt", cam->cfg->device_id, cam->cfg->device_name.c_str());
+
+    job_gen = 0;
+    pthread_mutex_lock(&pool_mutex);
+    while (true) {
+        while ((pool_gen == job_gen) && (pool_stop == false)) {
+            pthread_cond_wait(&pool_cond_start, &pool_mutex);
+        }
+        if (pool_stop) {
+            break;
+        }
+        job_gen = pool_gen;
+        pthread_mutex_unlock(&pool_mutex);
+
+        pool_work();
+
+        pthread_mutex_lock(&pool_mutex);
+        pool_working--;
+        if (pool_working == 0) {
+            pthread_cond_signal(&pool_cond_done);
+        }
+    }
+    pthread_mutex_unlock(&pool_mutex);
+}
+
+/*
+ * Process all the bands with the job.  The camera thread works on bands
+ * as well and then waits for the workers to finish their last band.
+ */
+void cls_alg::pool_run(enum ALG_JOB job)
+{
+    int indx;
+
+    pool_job = job;
+
+    if (pool_cnt == 0) {
+        for (indx = 0; indx < band_cnt; indx++) {
+            band_process(&bands[indx]);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&pool_mutex);
+        band_next = 0;
+        pool_working = pool_cnt;
+        pool_gen++;
+        pthread_cond_broadcast(&pool_cond_start);
+    pthread_mutex_unlock(&pool_mutex);
+
+    pool_work();
+
+    pthread_mutex_lock(&pool_mutex);
+        while (pool_working > 0) {
+            pthread_cond_wait(&pool_cond_done, &pool_mutex);
+        }
+    pthread_mutex_unlock(&pool_mutex);
+}
+
+/*
+ * Split the image into horizontal bands.  When using multiple threads
+ * there are several bands per thread so that a slow band does not hold
+ * up the others but each band is kept to a minimum number of rows.
+ * The bands start on a tile boundary so each tile belongs to one band.
+ */
+void cls_alg::pool_init()
+{
+    int indx, retcd;
+    int width = cam->imgs.width;
+    int height = cam->imgs.height;
+
+    pool_cnt = cam->cfg->detect_threads - 1;
+    pool_gen = 0;
+    pool_working = 0;
+    pool_stop = false;
+    pool_job = ALG_JOB_NONE;
+    pool_img = nullptr;
+    pool_dst = nullptr;
+    pool_map_src = nullptr;
+    pool_map_dst = nullptr;
+    pool_flag = 0;
+    pool_location = false;
+    pool_thread = nullptr;
+    band_next = 0;
+
+    if (pool_cnt > 0) {
+        band_cnt = MIN(cam->cfg->detect_threads * 4, height / 16);
+    } else {
+        band_cnt = 1;
+    }
+    if (band_cnt < 2) {
+        band_cnt = 1;
+        pool_cnt = 0;
+    }
+
+    bands = (ctx_alg_band*)mymalloc((uint)band_cnt * sizeof(ctx_alg_band));
+    band_buffer = (u_char*)mymalloc((uint)(band_cnt * width));
+    band_colcnt = (int*)mymalloc((uint)(band_cnt * width) * sizeof(*band_colcnt));
+    for (indx = 0; indx < band_cnt; indx++) {
+        bands[indx].row_beg = ((height / TILE_SIZE) * indx / band_cnt) * TILE_SIZE;
+        if (indx == band_cnt - 1) {
+            bands[indx].row_end = height;
+        } else {
+            bands[indx].row_end = ((height / TILE_SIZE) * (indx + 1) / band_cnt) * TILE_SIZE;
+        }
+        bands[indx].buffer = band_buffer + (indx * width);
+        bands[indx].colcnt = band_colcnt + (indx * width);
+        bands[indx].sum = 0;
+        bands[indx].tiles = 0;
+    }
+
+    pthread_mutex_init(&pool_mutex, NULL);
+    pthread_cond_init(&pool_cond_start, NULL);
+    pthread_cond_init(&pool_cond_done, NULL);
+
+    if (pool_cnt == 0) {
+        return;
+    }
+
+    pool_thread = (pthread_t*)mymalloc((uint)pool_cnt * sizeof(pthread_t));
+    for (indx = 0; indx < pool_cnt; indx++) {
+        retcd = pthread_create(&pool_thread[indx], NULL, &alg_pool_handler, this);
+        if (retcd != 0) {
+            MOTION_LOG(WRN, TYPE_ALL, NO_ERRNO
+                ,_("Unable to start detection thread %d"), indx + 1);
+            pool_cnt = indx;
+            break;
+        }
+    }
+
+    MOTION_LOG(INF, TYPE_ALL, NO_ERRNO
+        ,_("Motion detection using %d threads and %d bands")
+        , pool_cnt + 1, band_cnt);
+}
+
+void cls_alg::pool_deinit()
+{
+    int indx;
+
+    if (pool_cnt > 0) {
+        pthread_mutex_lock(&pool_mutex);
+            pool_stop = true;
+            pthread_cond_broadcast(&pool_cond_start);
+        pthread_mutex_unlock(&pool_mutex);
+        for (indx = 0; indx < pool_cnt; indx++) {
+            pthread_join(pool_thread[indx], NULL);
+        }
+    }
+    myfree(pool_thread);
+
+    pthread_mutex_destroy(&pool_mutex);
+    pthread_cond_destroy(&pool_cond_start);
+    pthread_cond_destroy(&pool_cond_done);
+
+    myfree(bands);
+    myfree(band_buffer);
+    myfree(band_colcnt);
 }
 
 cls_alg::cls_alg(cls_camera *p_cam)
@@ -1060,6 +1878,20 @@ cls_alg::cls_alg(cls_camera *p_cam)
     smartmask =(unsigned char*) mymalloc((uint)cam->imgs.motionsize);
     smartmask_final =(unsigned char*) mymalloc((uint)cam->imgs.motionsize);
     smartmask_buffer =(int*) mymalloc((uint)cam->imgs.motionsize * sizeof(*smartmask_buffer));
+    loc_colcnt =(int*) mymalloc((uint)cam->imgs.width * sizeof(*loc_colcnt));
+    loc_rowcnt =(int*) mymalloc((uint)cam->imgs.height * sizeof(*loc_rowcnt));
+    run_cnt = 0;
+    run_max = cam->imgs.width * 4;
+    runs =(ctx_alg_run*) mymalloc((uint)run_max * sizeof(ctx_alg_run));
+    track_on = false;
+    track_cnt = 0;
+    track_id = 0;
+    label_max = 256;
+    label_box =(ctx_coord*) mymalloc((uint)label_max * sizeof(ctx_coord));
+    label_sum =(int64_t*) mymalloc((uint)label_max * 2 * sizeof(int64_t));
+    morph_buf =(u_char*) mymalloc((uint)cam->imgs.motionsize);
+    morph_edge =(u_char*) mymalloc((uint)(2 * cam->imgs.width));
+    morph_map =(u_char*) mymalloc((uint)(cam->imgs.tile_cols * cam->imgs.tile_rows));
 
     memset(smartmask, 0, (uint)cam->imgs.motionsize);
     memset(smartmask_final, 255, (uint)cam->imgs.motionsize);
@@ -1069,6 +1901,14 @@ cls_alg::cls_alg(cls_camera *p_cam)
         diffs_last[i] = 0;
     }
 
+    simd_avx2 = false;
+    #if defined(HAVE_ALG_AVX2)
+        simd_avx2 = alg_cpu_avx2();
+    #endif
+
+    despeckle_init();
+    pool_init();
+
 }
 
 cls_alg::~cls_alg()
@@ -1076,6 +1916,16 @@ cls_alg::~cls_alg()
     myfree(smartmask);
     myfree(smartmask_final);
     myfree(smartmask_buffer);
+    myfree(loc_colcnt);
+    myfree(loc_rowcnt);
+    myfree(runs);
+    myfree(label_box);
+    myfree(label_sum);
+    myfree(morph_buf);
+    myfree(morph_edge);
+    myfree(morph_map);
+
+    pool_deinit();
 
 }
 
@@ -20,6 +20,43 @@
 #define _INCLUDE_ALG_HPP_
     #define THRESHOLD_TUNE_LENGTH  256
 
+    enum ALG_JOB {
+        ALG_JOB_NONE,
+        ALG_JOB_DIFF,
+        ALG_JOB_ERODE9,
+        ALG_JOB_ERODE5,
+        ALG_JOB_DILATE9,
+        ALG_JOB_DILATE5,
+        ALG_JOB_REFUPD,
+        ALG_JOB_FUSED,
+        ALG_JOB_PROJ
+    };
+
+    struct ctx_alg_band {
+        int     row_beg;        /* First row of the band */
+        int     row_end;        /* One past the last row of the band */
+        u_char  *buffer;        /* Working row for the erode/dilate */
+        int     *colcnt;        /* Motion pixels per column within the band */
+        int     sum;            /* Diffs or pixel count result for the band */
+        int     tiles;          /* Dirty tiles in the band */
+    };
+
+    struct ctx_alg_run {
+        int     y;
+        int     x_beg;          /* First pixel of the run */
+        int     x_end;          /* One past the last pixel of the run */
+        int     parent;         /* Index of the parent run within the group */
+        int     size;           /* Pixels in the group (root only) */
+        int     label;          /* Label number of the group (root only) */
+    };
+
+    struct ctx_alg_track {
+        ctx_object  obj;
+        int         frames;         /* Images the object was seen in */
+        int         missed;         /* Images since the object was last seen */
+        bool        event;          /* Seen while an event was in progress */
+    };
+
     class cls_alg {
         public:
             cls_alg(cls_camera *p_cam);
@@ -32,32 +69,94 @@
             void ref_frame_reset();
             void stddev();
             void location();
+            void tune_fused(bool do_noise, bool do_location);
+            void track();
+            bool track_slow();
+            bool    track_on;       /* Objects are tracked on this image */
             u_char  *smartmask_final;
+            ctx_coord *label_box;   /* Box and center of each label, by label - 2 */
+            void    pool_handler();
         private:
             cls_camera *cam;
             int     smartmask_count;
             u_char  *smartmask;
             int     *smartmask_buffer;
+            int     *loc_colcnt;    /* Count of motion pixels in each column */
+            int     *loc_rowcnt;    /* Count of motion pixels in each row */
             int     diffs_last[THRESHOLD_TUNE_LENGTH];
+            bool    simd_avx2;
+            ctx_alg_run *runs;      /* Runs of motion pixels for the labeling */
+            int     run_cnt;
+            int     run_max;
+            int64_t *label_sum;     /* Sums of the x and y of the pixels of each label */
+            int     label_max;      /* Labels that label_box and label_sum can hold */
+            ctx_alg_track track_list[OBJECT_MAX];
+            int     track_cnt;
+            int     track_id;       /* Last id given to an object */
+            u_char  *morph_buf;     /* Alternate image for the erode/dilate steps */
+            u_char  *morph_edge;    /* Rows of zero and flag values outside the image */
+            u_char  *morph_map;     /* Dirty tiles of the morph buffer */
+            std::vector<enum ALG_JOB> despeckle_plan;
+            bool    despeckle_label;
+
+            pthread_t       *pool_thread;
+            pthread_mutex_t pool_mutex;
+            pthread_cond_t  pool_cond_start;
+            pthread_cond_t  pool_cond_done;
+            int             pool_cnt;       /* Worker threads in addition to the camera thread */
+            int             pool_gen;       /* Incremented for each job given to the workers */
+            int             pool_working;   /* Workers that have not yet finished the job */
+            bool            pool_stop;
+            enum ALG_JOB    pool_job;
+            u_char          *pool_img;      /* Source image for the erode/dilate jobs */
+            u_char          *pool_dst;      /* Destination image for the erode/dilate jobs */
+            u_char          *pool_map_src;  /* Dirty tiles of pool_img or NULL for all */
+            u_char          *pool_map_dst;  /* Dirty tiles of pool_dst */
+            u_char          pool_flag;      /* Border value for the erode jobs */
+            bool            pool_location;  /* Whether the fused job counts the location */
+            ctx_alg_band    *bands;
+            int             band_cnt;
+            int             band_next;      /* Next band to be processed */
+            u_char          *band_buffer;
+            int             *band_colcnt;
 
-            int iflood(int x, int y, int width, int height,
-                u_char *out, int *labels, int newvalue, int oldvalue);
+            int label_find(int indx);
+            void label_union(int indx1, int indx2);
             int labeling();
-            int dilate9(u_char *img, int width, int height, void *buffer);
-            int dilate5(u_char *img, int width, int height, void *buffer);
-            int erode9(u_char *img, int width, int height, void *buffer, u_char flag);
-            int erode5(u_char *img, int width, int height, void *buffer, u_char flag);
+            void label_boxes();
+            int track_objects(ctx_object *obj);
+            void track_match(ctx_object *obj, int obj_cnt, int *obj_trk);
+            int tile_mark(u_char *img, u_char *map, int y);
+            bool tile_span(u_char *row_map, int *x_beg, int *x_end);
+            int morph_span(u_char *vert, int y, int x_beg, int x_end);
+            bool morph_tile_active(int tx, int ty);
+            int morph_band(ctx_alg_band *band);
+            int morph_run(enum ALG_JOB job, u_char *img, u_char *dst, u_char flag);
+            int morph_run_tiles(enum ALG_JOB job, u_char *img, u_char *dst
+                , u_char *map_img, u_char *map_dst);
+            void morph_copy_back();
+            void despeckle_init();
             void despeckle();
-            void diff_nomask();
-            void diff_mask();
-            void diff_smart();
-            void diff_masksmart();
+            int diff_nomask(int pix_beg, int pix_end);
+            int diff_mask(int pix_beg, int pix_end);
+            int diff_smart(int pix_beg, int pix_end);
+            int diff_masksmart(int pix_beg, int pix_end);
+            int diff_band(ctx_alg_band *band);
             bool diff_fast();
             void diff_standard();
             void lightswitch();
-            void location_center();
-            void location_dist();
             void location_minmax();
+            void location_proj();
+            void location_sum();
+            void proj_band(ctx_alg_band *band);
+            void ref_update_band(ctx_alg_band *band);
+            int ref_accept_timer();
+            void fused_band(ctx_alg_band *band);
+            void band_process(ctx_alg_band *band);
+            void pool_work();
+            void pool_run(enum ALG_JOB job);
+            void pool_init();
+            void pool_deinit();
 
     };
 
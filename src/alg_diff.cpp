@@ -0,0 +1,271 @@
+/*
+ *    This file is part of Motion.
+ *
+ *    Motion is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    Motion is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Motion.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/param.h>
+#include <stdint.h>
+#include "alg_diff.hpp"
+
+/*
+ * Vector kernels for the diff family.  Each kernel processes whole vectors
+ * from the start of the image and returns the number of pixels handled so
+ * that alg_diff_scalar finishes the tail.  The results are
+ * bit exact with the scalar code:
+ *   abs(ref - new) * mask / 255 == (p + 1 + (p >> 8)) >> 8 for p <= 65025
+ *   abs(curdiff) > noise        == saturated (diff - noise) != 0
+ * Negative noise values can not be expressed with unsigned saturation so the
+ * kernels decline them and leave all the work to the scalar loop.
+ */
+#if defined(HAVE_ALG_SSE2)
+
+int alg_diff_sse2(ctx_diff_vec *dv)
+{
+    int i, bits;
+    __m128i vref, vnew, vdif, vstill, vmask, vlo, vhi;
+    const __m128i vzero = _mm_setzero_si128();
+    const __m128i vone = _mm_set1_epi16(1);
+    const __m128i vnoise = _mm_set1_epi8((char)MIN(dv->noise, 255));
+
+    for (i = 0; i + 16 <= dv->imgsz; i += 16) {
+        vref = _mm_loadu_si128((const __m128i *)(dv->ref + i));
+        vnew = _mm_loadu_si128((const __m128i *)(dv->new_img + i));
+        vdif = _mm_or_si128(_mm_subs_epu8(vref, vnew), _mm_subs_epu8(vnew, vref));
+
+        if (dv->mask != NULL) {
+            vmask = _mm_loadu_si128((const __m128i *)(dv->mask + i));
+            vlo = _mm_mullo_epi16(_mm_unpacklo_epi8(vdif, vzero)
+                , _mm_unpacklo_epi8(vmask, vzero));
+            vhi = _mm_mullo_epi16(_mm_unpackhi_epi8(vdif, vzero)
+                , _mm_unpackhi_epi8(vmask, vzero));
+            vlo = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(vlo, vone)
+                , _mm_srli_epi16(vlo, 8)), 8);
+            vhi = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(vhi, vone)
+                , _mm_srli_epi16(vhi, 8)), 8);
+            vdif = _mm_packus_epi16(vlo, vhi);
+        }
+
+        vstill = _mm_cmpeq_epi8(_mm_subs_epu8(vdif, vnoise), vzero);
+
+        if (dv->mask_final != NULL) {
+            if (dv->mask_upd) {
+                bits = ~_mm_movemask_epi8(vstill) & 0xFFFF;
+                while (bits) {
+                    dv->mask_buffer[i + __builtin_ctz((uint)bits)] += SMARTMASK_SENSITIVITY_INCR;
+                    bits &= bits - 1;
+                }
+            }
+            vstill = _mm_or_si128(vstill, _mm_cmpeq_epi8(
+                _mm_loadu_si128((const __m128i *)(dv->mask_final + i)), vzero));
+        }
+
+        _mm_storeu_si128((__m128i *)(dv->out + i), _mm_andnot_si128(vstill, vnew));
+        dv->diffs += 16 - __builtin_popcount((uint)_mm_movemask_epi8(vstill));
+    }
+
+    return i;
+}
+
+#endif
+
+#if defined(HAVE_ALG_AVX2)
+
+__attribute__((target("avx2")))
+int alg_diff_avx2(ctx_diff_vec *dv)
+{
+    int i;
+    uint bits;
+    __m256i vref, vnew, vdif, vstill, vmask, vlo, vhi;
+    const __m256i vzero = _mm256_setzero_si256();
+    const __m256i vone = _mm256_set1_epi16(1);
+    const __m256i vnoise = _mm256_set1_epi8((char)MIN(dv->noise, 255));
+
+    for (i = 0; i + 32 <= dv->imgsz; i += 32) {
+        vref = _mm256_loadu_si256((const __m256i *)(dv->ref + i));
+        vnew = _mm256_loadu_si256((const __m256i *)(dv->new_img + i));
+        vdif = _mm256_or_si256(_mm256_subs_epu8(vref, vnew), _mm256_subs_epu8(vnew, vref));
+
+        if (dv->mask != NULL) {
+            /* The unpack and pack both work within 128 bit lanes so the byte order is kept */
+            vmask = _mm256_loadu_si256((const __m256i *)(dv->mask + i));
+            vlo = _mm256_mullo_epi16(_mm256_unpacklo_epi8(vdif, vzero)
+                , _mm256_unpacklo_epi8(vmask, vzero));
+            vhi = _mm256_mullo_epi16(_mm256_unpackhi_epi8(vdif, vzero)
+                , _mm256_unpackhi_epi8(vmask, vzero));
+            vlo = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(vlo, vone)
+                , _mm256_srli_epi16(vlo, 8)), 8);
+            vhi = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(vhi, vone)
+                , _mm256_srli_epi16(vhi, 8)), 8);
+            vdif = _mm256_packus_epi16(vlo, vhi);
+        }
+
+        vstill = _mm256_cmpeq_epi8(_mm256_subs_epu8(vdif, vnoise), vzero);
+
+        if (dv->mask_final != NULL) {
+            if (dv->mask_upd) {
+                bits = ~(uint)_mm256_movemask_epi8(vstill);
+                while (bits) {
+                    dv->mask_buffer[i + __builtin_ctz(bits)] += SMARTMASK_SENSITIVITY_INCR;
+                    bits &= bits - 1;
+                }
+            }
+            vstill = _mm256_or_si256(vstill, _mm256_cmpeq_epi8(
+                _mm256_loadu_si256((const __m256i *)(dv->mask_final + i)), vzero));
+        }
+
+        _mm256_storeu_si256((__m256i *)(dv->out + i), _mm256_andnot_si256(vstill, vnew));
+        dv->diffs += 32 - __builtin_popcount((uint)_mm256_movemask_epi8(vstill));
+    }
+
+    return i;
+}
+
+/* AVX2 needs both the cpu flag and the OS saving the ymm registers */
+bool alg_cpu_avx2()
+{
+    uint eax, ebx, ecx, edx, xcr0_lo, xcr0_hi;
+
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0) {
+        return false;
+    }
+    if ((ecx & bit_OSXSAVE) == 0) {
+        return false;
+    }
+    __asm__ volatile ("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+    if ((xcr0_lo & 0x06) != 0x06) {
+        return false;
+    }
+    if (__get_cpuid_max(0, NULL) < 7) {
+        return false;
+    }
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+
+    return ((ebx & bit_AVX2) != 0);
+}
+
+#endif
+
+#if defined(HAVE_ALG_NEON)
+
+int alg_diff_neon(ctx_diff_vec *dv)
+{
+    int i, indx;
+    uint8x16_t vref, vnew, vdif, vmot, vmask;
+    uint16x8_t vlo, vhi;
+    u_char mot[16];
+    const uint16x8_t vone = vdupq_n_u16(1);
+    const uint8x16_t vnoise = vdupq_n_u8((u_char)MIN(dv->noise, 255));
+
+    for (i = 0; i + 16 <= dv->imgsz; i += 16) {
+        vref = vld1q_u8(dv->ref + i);
+        vnew = vld1q_u8(dv->new_img + i);
+        vdif = vabdq_u8(vref, vnew);
+
+        if (dv->mask != NULL) {
+            vmask = vld1q_u8(dv->mask + i);
+            vlo = vmull_u8(vget_low_u8(vdif), vget_low_u8(vmask));
+            vhi = vmull_u8(vget_high_u8(vdif), vget_high_u8(vmask));
+            vlo = vaddq_u16(vaddq_u16(vlo, vone), vshrq_n_u16(vlo, 8));
+            vhi = vaddq_u16(vaddq_u16(vhi, vone), vshrq_n_u16(vhi, 8));
+            vdif = vcombine_u8(vshrn_n_u16(vlo, 8), vshrn_n_u16(vhi, 8));
+        }
+
+        vmot = vcgtq_u8(vdif, vnoise);
+
+        if (dv->mask_final != NULL) {
+            if (dv->mask_upd && (vmaxvq_u8(vmot) != 0)) {
+                vst1q_u8(mot, vmot);
+                for (indx = 0; indx < 16; indx++) {
+                    if (mot[indx]) {
+                        dv->mask_buffer[i + indx] += SMARTMASK_SENSITIVITY_INCR;
+                    }
+                }
+            }
+            vmot = vandq_u8(vmot, vtstq_u8(vld1q_u8(dv->mask_final + i)
+                , vdupq_n_u8(0xFF)));
+        }
+
+        vst1q_u8(dv->out + i, vandq_u8(vmot, vnew));
+        dv->diffs += vaddvq_u8(vshrq_n_u8(vmot, 7));
+    }
+
+    return i;
+}
+
+#endif
+
+/*
+ * Diff the pixels from indx to the end one at a time.  This is the reference
+ * that the kernels must match and it finishes the tail they leave behind.
+ * Returns the diffs including those already counted by a kernel.
+ */
+int alg_diff_scalar(ctx_diff_vec *dv, int indx)
+{
+    int curdiff;
+
+    for (; indx < dv->imgsz; indx++) {
+        curdiff = (dv->ref[indx] - dv->new_img[indx]);
+        if (dv->mask != NULL) {
+            curdiff = ((curdiff * dv->mask[indx]) / 255);
+        }
+
+        if (dv->mask_final != NULL) {
+            if (abs(curdiff) > dv->noise) {
+                if (dv->mask_upd) {
+                    dv->mask_buffer[indx] += SMARTMASK_SENSITIVITY_INCR;
+                }
+                if (!dv->mask_final[indx]) {
+                    curdiff = 0;
+                }
+            }
+        }
+
+        /* Pixel still in motion after all the masks? */
+        if (abs(curdiff) > dv->noise) {
+            dv->out[indx] = dv->new_img[indx];
+            dv->diffs++;
+        } else {
+            dv->out[indx] = 0;
+        }
+    }
+
+    return dv->diffs;
+}
+
+/* Run the widest diff kernel available and return the pixels processed */
+int alg_diff_vec(ctx_diff_vec *dv, bool use_avx2)
+{
+    if (dv->noise < 0) {
+        return 0;
+    }
+
+    #if defined(HAVE_ALG_AVX2)
+        if (use_avx2) {
+            return alg_diff_avx2(dv);
+        }
+    #else
+        (void)use_avx2;
+    #endif
+    #if defined(HAVE_ALG_SSE2)
+        return alg_diff_sse2(dv);
+    #elif defined(HAVE_ALG_NEON)
+        return alg_diff_neon(dv);
+    #else
+        (void)dv;
+        return 0;
+    #endif
+}
@@ -0,0 +1,64 @@
+/*
+ *    This file is part of Motion.
+ *
+ *    Motion is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    Motion is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Motion.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef _INCLUDE_ALG_DIFF_HPP_
+#define _INCLUDE_ALG_DIFF_HPP_
+
+    #if defined(__SSE2__)
+        #include <emmintrin.h>
+        #define HAVE_ALG_SSE2
+        #if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+            #include <cpuid.h>
+            #include <immintrin.h>
+            #define HAVE_ALG_AVX2
+        #endif
+    #elif defined(__ARM_NEON) && defined(__aarch64__)
+        #include <arm_neon.h>
+        #define HAVE_ALG_NEON
+    #endif
+
+    /* Increment for *smartmask_buffer in alg_diff_standard. */
+    #define SMARTMASK_SENSITIVITY_INCR 5
+
+    /* Only the system headers are needed so the check program builds these alone */
+    struct ctx_diff_vec {
+        u_char  *ref;
+        u_char  *new_img;
+        u_char  *out;
+        u_char  *mask;          /* Fixed mask or NULL */
+        u_char  *mask_final;    /* Smart mask or NULL when not in use */
+        int     *mask_buffer;   /* Smart mask accumulation buffer */
+        int     imgsz;
+        int     noise;
+        int     diffs;          /* Count of pixels with motion */
+        bool    mask_upd;       /* Accumulate into the mask_buffer */
+    };
+
+    int alg_diff_scalar(ctx_diff_vec *dv, int indx);
+    int alg_diff_vec(ctx_diff_vec *dv, bool use_avx2);
+    #if defined(HAVE_ALG_SSE2)
+        int alg_diff_sse2(ctx_diff_vec *dv);
+    #endif
+    #if defined(HAVE_ALG_AVX2)
+        int alg_diff_avx2(ctx_diff_vec *dv);
+        bool alg_cpu_avx2();
+    #endif
+    #if defined(HAVE_ALG_NEON)
+        int alg_diff_neon(ctx_diff_vec *dv);
+    #endif
+
+#endif /* _INCLUDE_ALG_DIFF_HPP_ */
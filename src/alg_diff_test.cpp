@@ -0,0 +1,230 @@
+/*
+ *    This file is part of Motion.
+ *
+ *    Motion is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    Motion is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with Motion.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Check that the vector kernels of the diff family give the same images,
+ * counts and smart mask buffers as the scalar code on random frames.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/param.h>
+#include <stdint.h>
+#include "alg_diff.hpp"
+
+#define TEST_IMGSZ  4099    /* Not a multiple of any vector so the tail is used */
+#define TEST_FRAMES 20
+
+typedef int (*diff_kernel)(ctx_diff_vec *dv);
+
+struct ctx_test_frame {
+    u_char  ref[TEST_IMGSZ];
+    u_char  new_img[TEST_IMGSZ];
+    u_char  mask[TEST_IMGSZ];
+    u_char  mask_final[TEST_IMGSZ];
+    int     mask_buffer[TEST_IMGSZ];
+};
+
+static const char *variant_name[] = {
+    "diff_nomask", "diff_mask", "diff_smart", "diff_masksmart"
+};
+
+static const int noise_list[] = {-1, 0, 1, 2, 127, 128, 254, 255, 256, 1000};
+
+/*
+ * Random pixels with runs of the extreme values so the saturation and the
+ * mask rounding are checked at 0 and 255.
+ */
+static void frame_fill(ctx_test_frame *frm)
+{
+    int indx;
+
+    for (indx = 0; indx < TEST_IMGSZ; indx++) {
+        frm->ref[indx] = (u_char)(rand() & 0xFF);
+        frm->new_img[indx] = (u_char)(rand() & 0xFF);
+        frm->mask[indx] = (u_char)(rand() & 0xFF);
+        frm->mask_final[indx] = (rand() & 1) ? 255 : 0;
+        frm->mask_buffer[indx] = rand() & 0xFFF;
+        if ((indx / 64) % 4 == 1) {
+            frm->ref[indx] = 0;
+            frm->new_img[indx] = 255;
+            frm->mask[indx] = (indx & 1) ? 255 : 0;
+        } else if ((indx / 64) % 4 == 2) {
+            /* Differences close to the noise values */
+            frm->new_img[indx] = (u_char)MIN(frm->ref[indx] + (rand() % 4), 255);
+        }
+    }
+}
+
+static void dv_init(ctx_diff_vec *dv, ctx_test_frame *frm, u_char *out
+    , int *mask_buffer, int variant, int noise, bool mask_upd)
+{
+    memcpy(mask_buffer, frm->mask_buffer, sizeof(frm->mask_buffer));
+    memset(out, 0xA5, TEST_IMGSZ);
+
+    dv->ref = frm->ref;
+    dv->new_img = frm->new_img;
+    dv->out = out;
+    dv->mask = ((variant == 1) || (variant == 3)) ? frm->mask : NULL;
+    dv->mask_final = (variant >= 2) ? frm->mask_final : NULL;
+    dv->mask_buffer = mask_buffer;
+    dv->imgsz = TEST_IMGSZ;
+    dv->noise = noise;
+    dv->diffs = 0;
+    dv->mask_upd = mask_upd;
+}
+
+/*
+ * The expected result written out the way the diff functions of the
+ * motion detection did it before the kernels were added.
+ */
+static int expect_diff(ctx_test_frame *frm, u_char *out, int *mask_buffer
+    , int variant, int noise, bool mask_upd)
+{
+    int indx, curdiff, diffs;
+
+    memcpy(mask_buffer, frm->mask_buffer, sizeof(frm->mask_buffer));
+    diffs = 0;
+    for (indx = 0; indx < TEST_IMGSZ; indx++) {
+        out[indx] = 0;
+        curdiff = (frm->ref[indx] - frm->new_img[indx]);
+        if ((variant == 1) || (variant == 3)) {
+            curdiff = ((curdiff * frm->mask[indx]) / 255);
+        }
+        if ((variant >= 2) && (abs(curdiff) > noise)) {
+            if (mask_upd) {
+                mask_buffer[indx] += SMARTMASK_SENSITIVITY_INCR;
+            }
+            if (!frm->mask_final[indx]) {
+                curdiff = 0;
+            }
+        }
+        if (abs(curdiff) > noise) {
+            out[indx] = frm->new_img[indx];
+            diffs++;
+        }
+    }
+
+    return diffs;
+}
+
+/* Nothing done by a vector unit so alg_diff_scalar does all of it */
+static int kernel_none(ctx_diff_vec *dv)
+{
+    (void)dv;
+    return 0;
+}
+
+static int kernel_dispatch(ctx_diff_vec *dv)
+{
+    #if defined(HAVE_ALG_AVX2)
+        return alg_diff_vec(dv, alg_cpu_avx2());
+    #else
+        return alg_diff_vec(dv, false);
+    #endif
+}
+
+/* Compare the kernel followed by the scalar tail with the expected result */
+static int check_kernel(const char *kernel_name, diff_kernel kernel
+    , ctx_test_frame *frm, int variant, int noise, bool mask_upd)
+{
+    ctx_diff_vec dv;
+    u_char out_ref[TEST_IMGSZ], out_vec[TEST_IMGSZ];
+    int buf_ref[TEST_IMGSZ], buf_vec[TEST_IMGSZ];
+    int indx, diffs_ref, diffs_vec;
+
+    diffs_ref = expect_diff(frm, out_ref, buf_ref, variant, noise, mask_upd);
+
+    dv_init(&dv, frm, out_vec, buf_vec, variant, noise, mask_upd);
+    diffs_vec = alg_diff_scalar(&dv, kernel(&dv));
+
+    if (diffs_ref != diffs_vec) {
+        printf("FAIL %s %s noise %d upd %d: diffs %d expected %d\n"
+            , kernel_name, variant_name[variant], noise, mask_upd
+            , diffs_vec, diffs_ref);
+        return 1;
+    }
+    for (indx = 0; indx < TEST_IMGSZ; indx++) {
+        if ((out_ref[indx] != out_vec[indx]) || (buf_ref[indx] != buf_vec[indx])) {
+            printf("FAIL %s %s noise %d upd %d: pixel %d out %d/%d buffer %d/%d\n"
+                , kernel_name, variant_name[variant], noise, mask_upd, indx
+                , out_vec[indx], out_ref[indx], buf_vec[indx], buf_ref[indx]);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int check_frames(const char *kernel_name, diff_kernel kernel, bool raw_kernel)
+{
+    ctx_test_frame *frm;
+    int frame, variant, noise, fails;
+    uint upd;
+
+    frm = (ctx_test_frame *)malloc(sizeof(ctx_test_frame));
+    fails = 0;
+    for (frame = 0; frame < TEST_FRAMES; frame++) {
+        frame_fill(frm);
+        for (variant = 0; variant < 4; variant++) {
+            for (noise = 0; noise < (int)(sizeof(noise_list) / sizeof(noise_list[0])); noise++) {
+                /* The kernels decline negative noise in alg_diff_vec */
+                if ((noise_list[noise] < 0) && (raw_kernel)) {
+                    continue;
+                }
+                for (upd = 0; upd < 2; upd++) {
+                    fails += check_kernel(kernel_name, kernel, frm, variant
+                        , noise_list[noise], (upd == 1));
+                }
+            }
+        }
+    }
+    free(frm);
+
+    printf("%s %s\n", (fails == 0) ? "PASS" : "FAIL", kernel_name);
+
+    return fails;
+}
+
+int main()
+{
+    int fails;
+
+    srand(4099);
+    fails = 0;
+
+    fails += check_frames("alg_diff_scalar", kernel_none, false);
+    fails += check_frames("alg_diff_vec", kernel_dispatch, false);
+
+    #if defined(HAVE_ALG_SSE2)
+        fails += check_frames("alg_diff_sse2", alg_diff_sse2, true);
+    #endif
+    #if defined(HAVE_ALG_AVX2)
+        if (alg_cpu_avx2()) {
+            fails += check_frames("alg_diff_avx2", alg_diff_avx2, true);
+        } else {
+            printf("SKIP alg_diff_avx2 (not supported by this cpu)\n");
+        }
+    #endif
+    #if defined(HAVE_ALG_NEON)
+        fails += check_frames("alg_diff_neon", alg_diff_neon, true);
+    #endif
+
+    return (fails == 0) ? 0 : 1;
+}
@@ -414,9 +414,21 @@ void cls_camera::cam_start()
     if (camera_type == CAMERA_TYPE_LIBCAM) {
         libcam = new cls_libcam(this);
     } else if (camera_type == CAMERA_TYPE_NETCAM) {
+        /*
+         * When both urls are the same stream and the high is only used for
+         * pass-through, one connection decodes for the norm and keeps the
+         * packets for the movies.
+         */
+        netcam_shared = ((cfg->netcam_high_url != "") &&
+            (cfg->netcam_high_url == cfg->netcam_url) &&
+            (movie_passthrough == true));
+        if (netcam_shared) {
+            MOTION_LOG(NTC, TYPE_VIDEO, NO_ERRNO
+                ,_("netcam_high_url is the same as netcam_url.  Sharing one connection."));
+        }
         netcam = new cls_netcam(this, false);
         netcam->netcam_start();
-        if (cfg->netcam_high_url != "") {
+        if ((cfg->netcam_high_url != "") && (netcam_shared == false)) {
             watchdog = cfg->watchdog_tmo;
             netcam_high = new cls_netcam(this, true);
             netcam_high->netcam_start();
@@ -588,11 +600,15 @@ void cls_camera::init_buffers()
 {
     imgs.ref =(u_char*) mymalloc((uint)imgs.size_norm);
     imgs.image_motion.image_norm = (u_char*)mymalloc((uint)imgs.size_norm);
-    imgs.ref_dyn =(int*) mymalloc((uint)imgs.motionsize * sizeof(*imgs.ref_dyn));
+    imgs.ref_dyn =(uint16_t*) mymalloc((uint)imgs.motionsize * sizeof(*imgs.ref_dyn));
     imgs.image_virgin =(u_char*) mymalloc((uint)imgs.size_norm);
     imgs.image_vprvcy = (u_char*)mymalloc((uint)imgs.size_norm);
-    imgs.labels =(int*)mymalloc((uint)imgs.motionsize * sizeof(*imgs.labels));
+    imgs.labels =(uint16_t*)mymalloc((uint)imgs.motionsize * sizeof(*imgs.labels));
     imgs.labelsize =(int*) mymalloc((uint)(imgs.motionsize/2+1) * sizeof(*imgs.labelsize));
+    imgs.tile_cols = (imgs.width + TILE_SIZE - 1) / TILE_SIZE;
+    imgs.tile_rows = (imgs.height + TILE_SIZE - 1) / TILE_SIZE;
+    imgs.tile_dirty =(u_char*) mymalloc((uint)(imgs.tile_cols * imgs.tile_rows));
+    imgs.tile_dirty_cnt = 0;
     imgs.image_preview.image_norm =(u_char*) mymalloc((uint)imgs.size_norm);
     imgs.common_buffer =(u_char*) mymalloc((uint)(3 * imgs.width * imgs.height));
     imgs.image_secondary =(u_char*) mymalloc((uint)(3 * imgs.width * imgs.height));
@@ -635,6 +651,7 @@ void cls_camera::init_values()
     info_reset();
 
     movie_passthrough = cfg->movie_passthrough;
+    netcam_shared = false;
     if ((camera_type != CAMERA_TYPE_NETCAM) &&
         (movie_passthrough)) {
         MOTION_LOG(WRN, TYPE_ALL, NO_ERRNO,_("Pass-through processing disabled."));
@@ -692,13 +709,22 @@ void cls_camera::init_cam_start()
 /* initialize reference images*/
 void cls_camera::init_ref()
 {
+    /* Without a privacy mask the virgin image is also the masked one */
+    if ((imgs.mask_privacy == NULL) &&
+        (imgs.image_vprvcy != imgs.image_virgin)) {
+        myfree(imgs.image_vprvcy);
+        imgs.image_vprvcy = imgs.image_virgin;
+    }
+
     memcpy(imgs.image_virgin, current_image->image_norm
         , (uint)imgs.size_norm);
 
     mask_privacy();
 
-    memcpy(imgs.image_vprvcy, current_image->image_norm
-        , (uint)imgs.size_norm);
+    if (imgs.image_vprvcy != imgs.image_virgin) {
+        memcpy(imgs.image_vprvcy, current_image->image_norm
+            , (uint)imgs.size_norm);
+    }
 
     alg->ref_frame_reset();
 }
@@ -727,10 +753,14 @@ void cls_camera::cleanup()
     myfree(imgs.image_motion.image_norm);
     myfree(imgs.ref);
     myfree(imgs.ref_dyn);
+    if (imgs.image_vprvcy == imgs.image_virgin) {
+        imgs.image_vprvcy = nullptr;
+    }
     myfree(imgs.image_virgin);
     myfree(imgs.image_vprvcy);
     myfree(imgs.labels);
     myfree(imgs.labelsize);
+    myfree(imgs.tile_dirty);
     myfree(imgs.mask);
     myfree(imgs.mask_privacy);
     myfree(imgs.mask_privacy_uv);
@@ -1298,6 +1328,7 @@ void cls_camera::resetimages()
     current_image->cent_dist = 0;
     memset(&current_image->location, 0, sizeof(current_image->location));
     current_image->total_labels = 0;
+    current_image->object_cnt = 0;
 
     clock_gettime(CLOCK_REALTIME, &current_image->imgts);
     clock_gettime(CLOCK_MONOTONIC, &current_image->monots);
@@ -1339,8 +1370,10 @@ int cls_camera::capture()
         memcpy(imgs.image_virgin, current_image->image_norm
             , (uint)imgs.size_norm);
         mask_privacy();
-        memcpy(imgs.image_vprvcy, current_image->image_norm
-            , (uint)imgs.size_norm);
+        if (imgs.image_vprvcy != imgs.image_virgin) {
+            memcpy(imgs.image_vprvcy, current_image->image_norm
+                , (uint)imgs.size_norm);
+        }
 
     } else {
         if (connectionlosttime.tv_sec == 0) {
@@ -1418,28 +1451,44 @@ void cls_camera::detection()
 /* tune the detection parameters*/
 void cls_camera::tuning()
 {
+    bool do_noise, do_location;
+
     if ((restart == true) || (handler_stop == true)) {
         return;
     }
 
-    if ((cfg->noise_tune && shots_mt == 0) && (pause == false) &&
-          (!detecting_motion && (current_image->diffs <= threshold))) {
-        alg->noise_tune();
-    }
+    if (cfg->detect_pipeline == "staged") {
+        if ((cfg->noise_tune && shots_mt == 0) && (pause == false) &&
+              (!detecting_motion && (current_image->diffs <= threshold))) {
+            alg->noise_tune();
+        }
 
-    if (cfg->threshold_tune && (pause == false)) {
-        alg->threshold_tune();
-    }
+        if (cfg->threshold_tune && (pause == false)) {
+            alg->threshold_tune();
+        }
 
-    if ((pause == false) &&
-        (current_image->diffs > threshold) &&
-        (current_image->diffs < threshold_maximum)) {
-        alg->location();
-    }
+        if ((pause == false) &&
+            (current_image->diffs > threshold) &&
+            (current_image->diffs < threshold_maximum)) {
+            alg->location();
+        }
 
-    if (pause == false) {
-        alg->tune_smartmask();
-        alg->ref_frame_update();
+        if (pause == false) {
+            alg->tune_smartmask();
+            alg->ref_frame_update();
+        }
+    } else if (pause == false) {
+        do_noise = ((cfg->noise_tune && shots_mt == 0) &&
+              (!detecting_motion && (current_image->diffs <= threshold)));
+
+        if (cfg->threshold_tune) {
+            alg->threshold_tune();
+        }
+
+        do_location = ((current_image->diffs > threshold) &&
+            (current_image->diffs < threshold_maximum));
+
+        alg->tune_fused(do_noise, do_location);
     }
 
     previous_diffs = current_image->diffs;
@@ -1682,7 +1731,8 @@ void cls_camera::actions()
     }
 
      if ((current_image->diffs > threshold) &&
-        (current_image->diffs < threshold_maximum)) {
+        (current_image->diffs < threshold_maximum) &&
+        (alg->track_slow() == false)) {
         current_image->motion = true;
         info_diff_cnt++;
         info_diff_tot += (uint)current_image->diffs;
@@ -2033,6 +2083,8 @@ void cls_camera::handler_shutdown()
 
 cls_camera::cls_camera(cls_motapp *p_app)
 {
+    pthread_condattr_t cond_attr;
+
     app = p_app;
 
     cfg = nullptr;
@@ -2092,7 +2144,25 @@ cls_camera::cls_camera(cls_motapp *p_app)
     pthread_mutex_init(&stream.mutex, NULL);
     device_status = STATUS_CLOSED;
     memset(&imgs, 0, sizeof(ctx_images));
-    memset(&stream, 0, sizeof(ctx_stream));
+    memset(&stream.norm, 0, sizeof(ctx_stream_data));
+    memset(&stream.sub, 0, sizeof(ctx_stream_data));
+    memset(&stream.motion, 0, sizeof(ctx_stream_data));
+    memset(&stream.source, 0, sizeof(ctx_stream_data));
+    memset(&stream.secondary, 0, sizeof(ctx_stream_data));
+    stream.wait_list.clear();
+    stream.frame_seq = 0;
+    memset(&stream.frame_ts, 0, sizeof(struct timespec));
+    stream.enc_frame = NULL;
+    stream.enc_busy = 0;
+    stream.enc_cnt = 0;
+    stream.enc_drop = 0;
+    stream.enc_usec = 0;
+    stream.enc_usec_max = 0;
+    stream.tile_dirty_cnt = 0;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&stream.cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
 }
 
 cls_camera::~cls_camera()
@@ -2100,5 +2170,6 @@ cls_camera::~cls_camera()
     mydelete(conf_src);
     mydelete(cfg);
     pthread_mutex_destroy(&stream.mutex);
+    pthread_cond_destroy(&stream.cond);
     device_status = STATUS_CLOSED;
 }
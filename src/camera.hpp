@@ -44,6 +44,16 @@ struct ctx_coord {
     int maxy;
 };
 
+#define OBJECT_MAX  16      /* Objects that are tracked at one time */
+
+struct ctx_object {
+    int         id;             /* Number that follows the object from image to image */
+    int         size;           /* Motion pixels of the object */
+    int         vx;             /* Speed of the center in pixels per second */
+    int         vy;
+    ctx_coord   box;            /* Bounding box and center of the object */
+};
+
 struct ctx_image_data {
     u_char       *image_norm;
     u_char       *image_high;
@@ -63,8 +73,12 @@ struct ctx_image_data {
     bool                save_movie;
     ctx_coord           location;       /* coordinates for center and size of last motion detection*/
     int                 total_labels;
+    ctx_object          objects[OBJECT_MAX];    /* Tracked objects seen in this image */
+    int                 object_cnt;
 };
 
+#define TILE_SIZE   16      /* Width and height of the tiles of the motion image */
+
 struct ctx_images {
     ctx_image_data *image_ring;    /* The base address of the image ring buffer */
     ctx_image_data image_motion;   /* Picture buffer for motion images */
@@ -87,8 +101,8 @@ struct ctx_images {
     int ring_in;                /* Index in image ring buffer we last added a image into */
     int ring_out;               /* Index in image ring buffer we want to process next time */
 
-    int *ref_dyn;               /* Dynamic objects to be excluded from reference frame */
-    int *labels;
+    uint16_t *ref_dyn;          /* Dynamic objects to be excluded from reference frame */
+    uint16_t *labels;           /* Only valid within the dirty tiles */
     int *labelsize;
 
     int width;
@@ -106,6 +120,11 @@ struct ctx_images {
     int largest_label;
     int size_secondary;             /* Size of the jpg put into image_secondary*/
 
+    int tile_cols;
+    int tile_rows;
+    u_char *tile_dirty;             /* Tiles of the motion image with any motion pixels */
+    int tile_dirty_cnt;
+
 };
 
 struct ctx_schedule_data {
@@ -171,6 +190,7 @@ class cls_camera {
         int     text_scale;
         int     watchdog;
         bool    movie_passthrough;
+        bool    netcam_shared;      /* The norm netcam also provides the packets of netcam_high_url */
         char    eventid[20];
         char    text_event_string[PATH_MAX];
         char    hostname[PATH_MAX];
@@ -53,6 +53,8 @@ ctx_parm config_parms[] = {
     {"netcam_high_url",           PARM_TYP_STRING, PARM_CAT_02, PARM_LVL_02, PARM_CHG_RESTART },
     {"netcam_high_params",        PARM_TYP_PARAMS, PARM_CAT_02, PARM_LVL_02, PARM_CHG_RESTART },
     {"netcam_userpass",           PARM_TYP_STRING, PARM_CAT_02, PARM_LVL_02, PARM_CHG_RESTART },
+    {"netcam_decode_threads",     PARM_TYP_INT,    PARM_CAT_02, PARM_LVL_02, PARM_CHG_RESTART },
+    {"netcam_start_max",          PARM_TYP_INT,    PARM_CAT_02, PARM_LVL_02, PARM_CHG_RESTART },
     {"libcam_device",             PARM_TYP_STRING, PARM_CAT_02, PARM_LVL_02, PARM_CHG_RESTART },
     {"libcam_params",             PARM_TYP_PARAMS, PARM_CAT_02, PARM_LVL_02, PARM_CHG_CODE },
 
@@ -89,6 +91,10 @@ ctx_parm config_parms[] = {
     {"lightswitch_frames",        PARM_TYP_INT,    PARM_CAT_07, PARM_LVL_01, PARM_CHG_COPY },
     {"minimum_motion_frames",     PARM_TYP_INT,    PARM_CAT_07, PARM_LVL_01, PARM_CHG_COPY },
     {"static_object_time",        PARM_TYP_INT,    PARM_CAT_07, PARM_LVL_01, PARM_CHG_COPY },
+    {"detect_pipeline",           PARM_TYP_LIST,   PARM_CAT_07, PARM_LVL_01, PARM_CHG_COPY },
+    {"detect_threads",            PARM_TYP_INT,    PARM_CAT_07, PARM_LVL_01, PARM_CHG_RESTART },
+    {"track_objects",             PARM_TYP_BOOL,   PARM_CAT_07, PARM_LVL_01, PARM_CHG_COPY },
+    {"track_slow_speed",          PARM_TYP_INT,    PARM_CAT_07, PARM_LVL_01, PARM_CHG_COPY },
     {"event_gap",                 PARM_TYP_INT,    PARM_CAT_07, PARM_LVL_01, PARM_CHG_COPY },
     {"pre_capture",               PARM_TYP_INT,    PARM_CAT_07, PARM_LVL_01, PARM_CHG_RESTART },
     {"post_capture",              PARM_TYP_INT,    PARM_CAT_07, PARM_LVL_01, PARM_CHG_COPY },
@@ -155,6 +161,7 @@ ctx_parm config_parms[] = {
     {"webcontrol_lock_minutes",   PARM_TYP_INT,    PARM_CAT_13, PARM_LVL_02, PARM_CHG_RESTART },
     {"webcontrol_lock_attempts",  PARM_TYP_INT,    PARM_CAT_13, PARM_LVL_02, PARM_CHG_RESTART },
     {"webcontrol_lock_script",    PARM_TYP_STRING, PARM_CAT_13, PARM_LVL_03, PARM_CHG_RESTART },
+    {"webcontrol_threads",        PARM_TYP_INT,    PARM_CAT_13, PARM_LVL_03, PARM_CHG_RESTART },
 
     {"stream_preview_scale",      PARM_TYP_INT,    PARM_CAT_14, PARM_LVL_01, PARM_CHG_RESTART },
     {"stream_preview_newline",    PARM_TYP_BOOL,   PARM_CAT_14, PARM_LVL_01, PARM_CHG_RESTART },
@@ -167,6 +174,7 @@ ctx_parm config_parms[] = {
     {"stream_maxrate",            PARM_TYP_INT,    PARM_CAT_14, PARM_LVL_01, PARM_CHG_RESTART },
     {"stream_scan_time",          PARM_TYP_INT,    PARM_CAT_14, PARM_LVL_01, PARM_CHG_RESTART },
     {"stream_scan_scale",         PARM_TYP_INT,    PARM_CAT_14, PARM_LVL_01, PARM_CHG_RESTART },
+    {"stream_encode_threads",     PARM_TYP_INT,    PARM_CAT_14, PARM_LVL_01, PARM_CHG_RESTART },
 
     {"database_type",             PARM_TYP_LIST,   PARM_CAT_15, PARM_LVL_02, PARM_CHG_RESTART },
     {"database_dbname",           PARM_TYP_STRING, PARM_CAT_15, PARM_LVL_02, PARM_CHG_RESTART },
@@ -725,6 +733,44 @@ void cls_config::edit_netcam_userpass(std::string &parm, enum PARM_ACT pact)
     MOTION_LOG(DBG, TYPE_ALL, NO_ERRNO,"%s:%s","netcam_userpass",_("netcam_userpass"));
 }
 
+void cls_config::edit_netcam_decode_threads(std::string &parm, enum PARM_ACT pact)
+{
+    int parm_in;
+    if (pact == PARM_ACT_DFLT) {
+        netcam_decode_threads = 0;
+    } else if (pact == PARM_ACT_SET) {
+        parm_in = atoi(parm.c_str());
+        if ((parm_in < 0) || (parm_in > 4096)) {
+            MOTION_LOG(NTC, TYPE_ALL, NO_ERRNO, _("Invalid netcam_decode_threads %d"),parm_in);
+        } else {
+            netcam_decode_threads = parm_in;
+        }
+    } else if (pact == PARM_ACT_GET) {
+        parm = std::to_string(netcam_decode_threads);
+    }
+    return;
+    MOTION_LOG(DBG, TYPE_ALL, NO_ERRNO,"%s:%s","netcam_decode_threads",_("netcam_decode_threads"));
+}
+
+void cls_config::edit_netcam_start_max(std::string &parm, enum PARM_ACT pact)
+{
+    int parm_in;
+    if (pact == PARM_ACT_DFLT) {
+        netcam_start_max = 0;
+    } else if (pact == PARM_ACT_SET) {
+        parm_in = atoi(parm.c_str());
+        if ((parm_in < 0) || (parm_in > 1024)) {
+            MOTION_LOG(NTC, TYPE_ALL, NO_ERRNO, _("Invalid netcam_start_max %d"),parm_in);
+        } else {
+            netcam_start_max = parm_in;
+        }
+    } else if (pact == PARM_ACT_GET) {
+        parm = std::to_string(netcam_start_max);
+    }
+    return;
+    MOTION_LOG(DBG, TYPE_ALL, NO_ERRNO,"%s:%s","netcam_start_max",_("netcam_start_max"));
+}
+
 void cls_config::edit_libcam_device(std::string &parm, enum PARM_ACT pact)
 {
     if (pact == PARM_ACT_DFLT) {
@@ -1268,6 +1314,78 @@ void cls_config::edit_static_object_time(std::string &parm, enum PARM_ACT pact)
     MOTION_LOG(DBG, TYPE_ALL, NO_ERRNO,"%s:%s","static_object_time",_("static_object_time"));
 }
 
+void cls_config::edit_detect_pipeline(std::string &parm, enum PARM_ACT pact)
+{
+    if (pact == PARM_ACT_DFLT) {
+        detect_pipeline = "fused";
+    } else if (pact == PARM_ACT_SET) {
+        if ((parm == "fused") || (parm == "staged")) {
+            detect_pipeline = parm;
+        } else if (parm == "") {
+            detect_pipeline = "fused";
+        } else {
+          MOTION_LOG(NTC, TYPE_ALL, NO_ERRNO, _("Invalid detect_pipeline %s"), parm.c_str());
+        }
+    } else if (pact == PARM_ACT_GET) {
+        parm = detect_pipeline;
+    } else if (pact == PARM_ACT_LIST) {
+        parm = "[\"fused\",\"staged\"]";
+    }
+    return;
+    MOTION_LOG(DBG, TYPE_ALL, NO_ERRNO,"%s:%s","detect_pipeline",_("detect_pipeline"));
+}
+
+void cls_config::edit_detect_threads(std::string &parm, enum PARM_ACT pact)
+{
+    int parm_in;
+    if (pact == PARM_ACT_DFLT) {
+        detect_threads = 1;
+    } else if (pact == PARM_ACT_SET) {
+        parm_in = atoi(parm.c_str());
+        if ((parm_in < 1) || (parm_in > 32)) {
+            MOTION_LOG(NTC, TYPE_ALL, NO_ERRNO, _("Invalid detect_threads %d"),parm_in);
+        } else {
+            detect_threads = parm_in;
+        }
+    } else if (pact == PARM_ACT_GET) {
+        parm = std::to_string(detect_threads);
+    }
+    return;
+    MOTION_LOG(DBG, TYPE_ALL, NO_ERRNO,"%s:%s","detect_threads",_("detect_threads"));
+}
+
+void cls_config::edit_track_objects(std::string &parm, enum PARM_ACT pact)
+{
+    if (pact == PARM_ACT_DFLT) {
+        track_objects = false;
+    } else if (pact == PARM_ACT_SET) {
+        edit_set_bool(track_objects, parm);
+    } else if (pact == PARM_ACT_GET) {
+        edit_get_bool(parm, track_objects);
+    }
+    return;
+    MOTION_LOG(DBG, TYPE_ALL, NO_ERRNO,"%s:%s","track_objects",_("track_objects"));
+}
+
+void cls_config::edit_track_slow_speed(std::string &parm, enum PARM_ACT pact)
+{
+    int parm_in;
+    if (pact == PARM_ACT_DFLT) {
+        track_slow_speed = 0;
+    } else if (pact == PARM_ACT_SET) {
+        parm_in = atoi(parm.c_str());
+        if ((parm_in < 0) || (parm_in > 10000)) {
+            MOTION_LOG(NTC, TYPE_ALL, NO_ERRNO, _("Invalid track_slow_speed %d"),parm_in);
+        } else {
+            track_slow_speed = parm_in;
+        }
+    } else if (pact == PARM_ACT_GET) {
+        parm = std::to_string(track_slow_speed);
+    }
+    return;
+    MOTION_LOG(DBG, TYPE_ALL, NO_ERRNO,"%s:%s","track_slow_speed",_("track_slow_speed"));
+}
+
 void cls_config::edit_event_gap(std::string &parm, enum PARM_ACT pact)
 {
     int parm_in;
@@ -2306,6 +2424,25 @@ void cls_config::edit_webcontrol_lock_script(std::string &parm, enum PARM_ACT pa
     MOTION_LOG(DBG, TYPE_ALL, NO_ERRNO,"%s:%s","webcontrol_lock_script",_("webcontrol_lock_script"));
 }
 
+void cls_config::edit_webcontrol_threads(std::string &parm, enum PARM_ACT pact)
+{
+    int parm_in;
+    if (pact == PARM_ACT_DFLT) {
+        webcontrol_threads = 0;
+    } else if (pact == PARM_ACT_SET) {
+        parm_in = atoi(parm.c_str());
+        if ((parm_in < 0) || (parm_in > 1024)) {
+            MOTION_LOG(NTC, TYPE_ALL, NO_ERRNO, _("Invalid webcontrol_threads %d"),parm_in);
+        } else {
+            webcontrol_threads = parm_in;
+        }
+    } else if (pact == PARM_ACT_GET) {
+        parm = std::to_string(webcontrol_threads);
+    }
+    return;
+    MOTION_LOG(DBG, TYPE_ALL, NO_ERRNO,"%s:%s","webcontrol_threads",_("webcontrol_threads"));
+}
+
 void cls_config::edit_stream_preview_scale(std::string &parm, enum PARM_ACT pact)
 {
     int parm_in;
@@ -2489,6 +2626,25 @@ void cls_config::edit_stream_scan_scale(std::string &parm, enum PARM_ACT pact)
     MOTION_LOG(DBG, TYPE_ALL, NO_ERRNO,"%s:%s","stream_scan_scale",_("stream_scan_scale"));
 }
 
+void cls_config::edit_stream_encode_threads(std::string &parm, enum PARM_ACT pact)
+{
+    int parm_in;
+    if (pact == PARM_ACT_DFLT) {
+        stream_encode_threads = 0;
+    } else if (pact == PARM_ACT_SET) {
+        parm_in = atoi(parm.c_str());
+        if ((parm_in < 0) || (parm_in > 64)) {
+            MOTION_LOG(NTC, TYPE_ALL, NO_ERRNO, _("Invalid stream_encode_threads %d"),parm_in);
+        } else {
+            stream_encode_threads = parm_in;
+        }
+    } else if (pact == PARM_ACT_GET) {
+        parm = std::to_string(stream_encode_threads);
+    }
+    return;
+    MOTION_LOG(DBG, TYPE_ALL, NO_ERRNO,"%s:%s","stream_encode_threads",_("stream_encode_threads"));
+}
+
 void cls_config::edit_database_type(std::string &parm, enum PARM_ACT pact)
 {
     if (pact == PARM_ACT_DFLT) {
@@ -2930,6 +3086,8 @@ void cls_config::edit_cat02(std::string parm_nm, std::string &parm_val, enum PAR
     } else if (parm_nm == "netcam_high_url") {       edit_netcam_high_url(parm_val, pact);
     } else if (parm_nm == "netcam_high_params") {    edit_netcam_high_params(parm_val, pact);
     } else if (parm_nm == "netcam_userpass") {       edit_netcam_userpass(parm_val, pact);
+    } else if (parm_nm == "netcam_decode_threads") { edit_netcam_decode_threads(parm_val, pact);
+    } else if (parm_nm == "netcam_start_max") {      edit_netcam_start_max(parm_val, pact);
     } else if (parm_nm == "libcam_device") {         edit_libcam_device(parm_val, pact);
     } else if (parm_nm == "libcam_params") {         edit_libcam_params(parm_val, pact);
     }
@@ -2991,6 +3149,10 @@ void cls_config::edit_cat07(std::string parm_nm, std::string &parm_val, enum PAR
     } else if (parm_nm == "lightswitch_frames") {      edit_lightswitch_frames(parm_val, pact);
     } else if (parm_nm == "minimum_motion_frames") {   edit_minimum_motion_frames(parm_val, pact);
     } else if (parm_nm == "static_object_time") {      edit_static_object_time(parm_val, pact);
+    } else if (parm_nm == "detect_pipeline") {         edit_detect_pipeline(parm_val, pact);
+    } else if (parm_nm == "detect_threads") {          edit_detect_threads(parm_val, pact);
+    } else if (parm_nm == "track_objects") {           edit_track_objects(parm_val, pact);
+    } else if (parm_nm == "track_slow_speed") {        edit_track_slow_speed(parm_val, pact);
     } else if (parm_nm == "event_gap") {               edit_event_gap(parm_val, pact);
     } else if (parm_nm == "pre_capture") {             edit_pre_capture(parm_val, pact);
     } else if (parm_nm == "post_capture") {            edit_post_capture(parm_val, pact);
@@ -3087,6 +3249,7 @@ void cls_config::edit_cat13(std::string parm_nm, std::string &parm_val, enum PAR
     } else if (parm_nm == "webcontrol_lock_minutes") {     edit_webcontrol_lock_minutes(parm_val, pact);
     } else if (parm_nm == "webcontrol_lock_attempts") {    edit_webcontrol_lock_attempts(parm_val, pact);
     } else if (parm_nm == "webcontrol_lock_script") {      edit_webcontrol_lock_script(parm_val, pact);
+    } else if (parm_nm == "webcontrol_threads") {          edit_webcontrol_threads(parm_val, pact);
     }
 
 }
@@ -3104,6 +3267,7 @@ void cls_config::edit_cat14(std::string parm_nm, std::string &parm_val, enum PAR
     } else if (parm_nm == "stream_maxrate") {              edit_stream_maxrate(parm_val, pact);
     } else if (parm_nm == "stream_scan_time") {            edit_stream_scan_time(parm_val, pact);
     } else if (parm_nm == "stream_scan_scale") {           edit_stream_scan_scale(parm_val, pact);
+    } else if (parm_nm == "stream_encode_threads") {       edit_stream_encode_threads(parm_val, pact);
     }
 
 }
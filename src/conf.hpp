@@ -131,6 +131,8 @@
             std::string     netcam_high_url;
             std::string     netcam_high_params;
             std::string     netcam_userpass;
+            int             netcam_decode_threads;
+            int             netcam_start_max;
 
             std::string     libcam_device;
             std::string     libcam_params;
@@ -167,6 +169,10 @@
             int             lightswitch_frames;
             int             minimum_motion_frames;
             int             static_object_time;
+            std::string     detect_pipeline;
+            int             detect_threads;
+            bool            track_objects;
+            int             track_slow_speed;
             int             event_gap;
             int             pre_capture;
             int             post_capture;
@@ -241,6 +247,7 @@
             int             webcontrol_lock_minutes;
             int             webcontrol_lock_attempts;
             std::string     webcontrol_lock_script;
+            int             webcontrol_threads;
 
             /* Live stream configuration parameters */
             int             stream_preview_scale;
@@ -254,6 +261,7 @@
             int             stream_maxrate;
             int             stream_scan_time;
             int             stream_scan_scale;
+            int             stream_encode_threads;
 
             /* Database and SQL configuration parameters */
             std::string     database_type;
@@ -378,6 +386,8 @@
             void edit_netcam_params(std::string &parm, enum PARM_ACT pact);
             void edit_netcam_url(std::string &parm, enum PARM_ACT pact);
             void edit_netcam_userpass(std::string &parm, enum PARM_ACT pact);
+            void edit_netcam_decode_threads(std::string &parm, enum PARM_ACT pact);
+            void edit_netcam_start_max(std::string &parm, enum PARM_ACT pact);
             void edit_libcam_device(std::string &parm, enum PARM_ACT pact);
             void edit_libcam_params(std::string &parm, enum PARM_ACT pact);
 
@@ -415,6 +425,10 @@
             void edit_minimum_motion_frames(std::string &parm, enum PARM_ACT pact);
             void edit_event_gap(std::string &parm, enum PARM_ACT pact);
             void edit_static_object_time(std::string &parm, enum PARM_ACT pact);
+            void edit_detect_pipeline(std::string &parm, enum PARM_ACT pact);
+            void edit_detect_threads(std::string &parm, enum PARM_ACT pact);
+            void edit_track_objects(std::string &parm, enum PARM_ACT pact);
+            void edit_track_slow_speed(std::string &parm, enum PARM_ACT pact);
             void edit_post_capture(std::string &parm, enum PARM_ACT pact);
             void edit_pre_capture(std::string &parm, enum PARM_ACT pact);
 
@@ -477,6 +491,7 @@
             void edit_webcontrol_lock_attempts(std::string &parm, enum PARM_ACT pact);
             void edit_webcontrol_lock_minutes(std::string &parm, enum PARM_ACT pact);
             void edit_webcontrol_lock_script(std::string &parm, enum PARM_ACT pact);
+            void edit_webcontrol_threads(std::string &parm, enum PARM_ACT pact);
             void edit_webcontrol_access(std::string &parm, enum PARM_ACT pact);
             void edit_webcontrol_port(std::string &parm, enum PARM_ACT pact);
             void edit_webcontrol_tls(std::string &parm, enum PARM_ACT pact);
@@ -491,6 +506,7 @@
             void edit_stream_preview_scale(std::string &parm, enum PARM_ACT pact);
             void edit_stream_quality(std::string &parm, enum PARM_ACT pact);
             void edit_stream_scan_scale(std::string &parm, enum PARM_ACT pact);
+            void edit_stream_encode_threads(std::string &parm, enum PARM_ACT pact);
             void edit_stream_scan_time(std::string &parm, enum PARM_ACT pact);
 
             void edit_database_busy_timeout(std::string &parm, enum PARM_ACT pact);
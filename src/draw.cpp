@@ -1416,27 +1416,45 @@ void cls_draw::red_location(ctx_coord *cent
 void cls_draw::locate()
 {
     ctx_images *imgs;
-    ctx_coord *p_loc;
-    u_char *image_norm;
+    ctx_image_data *img;
+    ctx_coord box;
+    int indx;
 
     if (cam->cfg->locate_motion_mode == "preview") {
         imgs = &cam->imgs;
-        p_loc = &cam->imgs.image_preview.location;
-        image_norm = cam->imgs.image_preview.image_norm;
+        img = &cam->imgs.image_preview;
     } else if (cam->cfg->locate_motion_mode == "on") {
         imgs = &cam->imgs;
-        p_loc = &cam->current_image->location;
-        image_norm = cam->current_image->image_norm;
+        img = cam->current_image;
     } else {
         return;
     }
 
+    if (cam->alg->track_on && (img->object_cnt > 0) &&
+        ((cam->cfg->locate_motion_style == "box") ||
+         (cam->cfg->locate_motion_style == "redbox"))) {
+        /* One box for each tracked object, aligned as for the location */
+        for (indx = 0; indx < img->object_cnt; indx++) {
+            box = img->objects[indx].box;
+            box.minx = MIN(box.minx + (box.minx % 2), imgs->width - 2);
+            box.miny = MIN(box.miny + (box.miny % 2), imgs->height - 2);
+            box.maxx = MAX(box.maxx - (box.maxx % 2), box.minx);
+            box.maxy = MAX(box.maxy - (box.maxy % 2), box.miny);
+            if (cam->cfg->locate_motion_style == "box") {
+                location(&box, imgs, imgs->width, img->image_norm);
+            } else {
+                red_location(&box, imgs, imgs->width, img->image_norm);
+            }
+        }
+        return;
+    }
+
     if ((cam->cfg->locate_motion_style == "box") ||
         (cam->cfg->locate_motion_style == "cross")) {
-        location(p_loc, imgs, imgs->width, image_norm);
+        location(&img->location, imgs, imgs->width, img->image_norm);
     } else if ((cam->cfg->locate_motion_style == "redbox")||
         (cam->cfg->locate_motion_style == "redcross")) {
-        red_location(p_loc, imgs, imgs->width, image_norm);
+        red_location(&img->location, imgs, imgs->width, img->image_norm);
     }
 
 }
@@ -1523,42 +1541,52 @@ void cls_draw::fixed_mask()
 
 void cls_draw::largest_label()
 {
-    int i, x, v, width, height, line;
+    int x, y, tx, ty, x_end, y_end, width, height, line, cline;
     ctx_images *imgs = &cam->imgs;
-    int *labels = imgs->labels;
-    u_char *out_y, *out_u, *out_v;
+    uint16_t *labels = imgs->labels;
+    u_char *out_u, *out_v;
     u_char *out = cam->imgs.image_motion.image_norm;
 
-    i = imgs->motionsize;
-    v = i + ((imgs->motionsize) / 4);
     width = imgs->width;
     height = imgs->height;
+    out_u = out + imgs->motionsize;
+    out_v = out_u + ((imgs->motionsize) / 4);
+
+    /* The labels are only valid within the dirty tiles. */
+    for (ty = 0; ty < imgs->tile_rows; ty++) {
+        y_end = MIN((ty + 1) * TILE_SIZE, height);
+        for (tx = 0; tx < imgs->tile_cols; tx++) {
+            if (imgs->tile_dirty[(ty * imgs->tile_cols) + tx] == 0) {
+                continue;
+            }
+            x_end = MIN((tx + 1) * TILE_SIZE, width);
+
+            /* Set U to 255 to make label appear blue. */
+            for (y = ty * TILE_SIZE; y < y_end; y += 2) {
+                line = y * width;
+                cline = (y / 2) * (width / 2);
+                for (x = tx * TILE_SIZE; x < x_end; x += 2) {
+                    if (labels[line + x] & 32768 || labels[line + x + 1] & 32768 ||
+                        labels[line + width + x] & 32768 ||
+                        labels[line + width + x + 1] & 32768) {
+
+                        out_u[cline + (x / 2)] = 255;
+                        out_v[cline + (x / 2)] = 128;
+                    }
+                }
+            }
 
-    /* Set U to 255 to make label appear blue. */
-    out_u = out + i;
-    out_v = out + v;
-    for (i = 0; i < height; i += 2) {
-        line = i * width;
-        for (x = 0; x < width; x += 2) {
-            if (labels[line + x] & 32768 || labels[line + x + 1] & 32768 ||
-                labels[line + width + x] & 32768 ||
-                labels[line + width + x + 1] & 32768) {
-
-                *out_u = 255;
-                *out_v = 128;
+            /* Set intensity for coloured label to have better visibility. */
+            for (y = ty * TILE_SIZE; y < y_end; y++) {
+                line = y * width;
+                for (x = tx * TILE_SIZE; x < x_end; x++) {
+                    if (labels[line + x] & 32768) {
+                        out[line + x] = 0;
+                    }
+                }
             }
-            out_u++;
-            out_v++;
         }
     }
-    out_y = out;
-    /* Set intensity for coloured label to have better visibility. */
-    for (i = 0; i < imgs->motionsize; i++) {
-        if (*labels++ & 32768) {
-            *out_y = 0;
-        }
-        out_y++;
-    }
 }
 
 cls_draw::cls_draw(cls_camera *p_cam)
@@ -710,20 +710,15 @@ static GLOBAL(int) _jpeg_mem_size(j_compress_ptr cinfo)
 }
 
 /*
- * put_jpeg_exif writes the EXIF APP1 chunk to the jpeg file.
+ * put_jpeg_exif writes the EXIF APP1 chunk built by jpgutl_exif to the jpeg file.
  * It must be called after jpeg_start_compress() but before
  * any image data is written by jpeg_write_scanlines().
  */
-static void put_jpeg_exif(j_compress_ptr cinfo, cls_camera *cam,
-        timespec *ts1, ctx_coord *box)
+static void put_jpeg_exif(j_compress_ptr cinfo, u_char *exif, uint exif_len)
 {
-    u_char *exif = NULL;
-    uint exif_len = jpgutl_exif(&exif, cam, ts1, box);
-
     if(exif_len > 0) {
         /* EXIF data lives in a JPEG APP1 marker */
         jpeg_write_marker(cinfo, JPEG_APP0 + 1, exif, exif_len);
-        free(exif);
     }
 }
 
@@ -842,10 +837,12 @@ int jpgutl_decode_jpeg (u_char *jpeg_data_in, int jpeg_data_len,
 
 }
 
-int jpgutl_put_yuv420p(u_char *dest_image, int image_size,
+/* Compress with an EXIF APP1 chunk that was already built by jpgutl_exif
+ * so that callers on other threads do not need the camera.
+ */
+int jpgutl_put_yuv420p_exif(u_char *dest_image, int image_size,
         u_char *input_image, int width, int height, int quality,
-        cls_camera *cam, timespec *ts1, ctx_coord *box)
-
+        u_char *exif, uint exif_len)
 {
     int i, j, jpeg_image_size;
 
@@ -900,9 +897,7 @@ int jpgutl_put_yuv420p(u_char *dest_image, int image_size,
 
     jpeg_start_compress(&cinfo, TRUE);
 
-    if (cam != NULL) {
-        put_jpeg_exif(&cinfo, cam, ts1, box);
-    }
+    put_jpeg_exif(&cinfo, exif, exif_len);
 
     /* If the image is not a multiple of 16, this overruns the buffers
      * we'll just pad those last bytes with zeros
@@ -932,9 +927,9 @@ int jpgutl_put_yuv420p(u_char *dest_image, int image_size,
 }
 
 
-int jpgutl_put_grey(u_char *dest_image, int image_size,
+int jpgutl_put_grey_exif(u_char *dest_image, int image_size,
         u_char *input_image, int width, int height, int quality,
-        cls_camera *cam, timespec *ts1, ctx_coord *box)
+        u_char *exif, uint exif_len)
 {
     int y, dest_image_size;
     JSAMPROW row_ptr[1];
@@ -970,9 +965,7 @@ int jpgutl_put_grey(u_char *dest_image, int image_size,
 
     jpeg_start_compress (&cjpeg, TRUE);
 
-    if (cam != NULL) {
-        put_jpeg_exif(&cjpeg, cam, ts1, box);
-    }
+    put_jpeg_exif(&cjpeg, exif, exif_len);
 
     row_ptr[0] = input_image;
 
@@ -988,3 +981,38 @@ int jpgutl_put_grey(u_char *dest_image, int image_size,
     return dest_image_size;
 }
 
+int jpgutl_put_yuv420p(u_char *dest_image, int image_size,
+        u_char *input_image, int width, int height, int quality,
+        cls_camera *cam, timespec *ts1, ctx_coord *box)
+{
+    int retcd;
+    u_char *exif = NULL;
+    uint exif_len = 0;
+
+    if (cam != NULL) {
+        exif_len = jpgutl_exif(&exif, cam, ts1, box);
+    }
+    retcd = jpgutl_put_yuv420p_exif(dest_image, image_size
+        , input_image, width, height, quality, exif, exif_len);
+    myfree(exif);
+
+    return retcd;
+}
+
+int jpgutl_put_grey(u_char *dest_image, int image_size,
+        u_char *input_image, int width, int height, int quality,
+        cls_camera *cam, timespec *ts1, ctx_coord *box)
+{
+    int retcd;
+    u_char *exif = NULL;
+    uint exif_len = 0;
+
+    if (cam != NULL) {
+        exif_len = jpgutl_exif(&exif, cam, ts1, box);
+    }
+    retcd = jpgutl_put_grey_exif(dest_image, image_size
+        , input_image, width, height, quality, exif, exif_len);
+    myfree(exif);
+
+    return retcd;
+}
@@ -29,6 +29,12 @@
     int jpgutl_put_grey(unsigned char *dest_image, int image_size,
         unsigned char *input_image, int width, int height, int quality,
         cls_camera *cam, timespec *ts1, ctx_coord *box);
+    int jpgutl_put_yuv420p_exif(unsigned char *dest_image, int image_size,
+        unsigned char *input_image, int width, int height, int quality,
+        unsigned char *exif, uint exif_len);
+    int jpgutl_put_grey_exif(unsigned char *dest_image, int image_size,
+        unsigned char *input_image, int width, int height, int quality,
+        unsigned char *exif, uint exif_len);
     uint jpgutl_exif(u_char **exif, cls_camera *cam
         , timespec *ts_in1, ctx_coord *box);
 
@@ -29,6 +29,7 @@
 #include "video_v4l2.hpp"
 #include "movie.hpp"
 #include "netcam.hpp"
+#include "webu_getimg.hpp"
 
 volatile enum MOTION_SIGNAL motsignal;
 
@@ -564,6 +565,9 @@ void cls_motapp::init(int p_argc, char *p_argv[])
     cam_delete = -1;
     cam_cnt = 0;
     snd_cnt = 0;
+    decode_threads = 0;
+    netcam_starting = 0;
+    jpgenc = nullptr;
     conf_src = nullptr;
     cfg = nullptr;
     dbse = nullptr;
@@ -603,6 +607,13 @@ void cls_motapp::init(int p_argc, char *p_argv[])
     schedule = new cls_schedule(this);
     init_webu();
 
+    if (cfg->stream_encode_threads > 0) {
+        jpgenc = new cls_webu_jpgenc(this);
+        if (jpgenc->thread_cnt == 0) {
+            mydelete(jpgenc);
+        }
+    }
+
     if ((cam_cnt > 0) || (snd_cnt > 0)) {
         for (indx=0; indx<cam_cnt; indx++) {
             cam_list[indx]->handler_startup();
@@ -641,6 +652,8 @@ void cls_motapp::deinit()
         mydelete(webu_list[indx]);
     }
 
+    mydelete(jpgenc);
+
     dbse->shutdown();
     mydelete(dbse);
 
@@ -56,6 +56,7 @@
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include <thread>
+#include <atomic>
 #include "zlib.h"
 
 #if defined(HAVE_PTHREAD_NP_H)
@@ -113,6 +114,8 @@ class cls_webu_html;
 class cls_webu_json;
 class cls_webu_text;
 class cls_webu_mpegts;
+class cls_webu_tsenc;
+class cls_webu_jpgenc;
 class cls_webu_post;
 class cls_webu_common;
 class cls_webu_stream;
@@ -131,9 +134,31 @@ enum DEVICE_STATUS {
     STATUS_OPENED    /* Successfully started the device */
 };
 
+/* An encoded jpg shared by the stream connections.  Once published to a
+ * stream the data is not changed while any connection holds a reference.
+ */
+struct ctx_stream_jpg {
+    u_char              *data;      /* Image compressed as JPG */
+    int                 sz;         /* The number of bytes for jpg */
+    int                 alloc_sz;   /* The allocated size of data */
+    int                 quality;    /* The quality used to encode the jpg */
+    uint64_t            frame_seq;  /* The image sequence the jpg was encoded from */
+    std::atomic<int>    refcnt;     /* The stream plus each connection using it */
+};
+
+/* A copy of a camera image waiting for the encoder pool.  The jobs for
+ * the streams that compress the same image share the copy.
+ */
+struct ctx_stream_frame {
+    u_char              *img;       /* Copy of the image */
+    u_char              *src;       /* Camera image that was copied */
+    uint64_t            frame_seq;  /* The image sequence of the copy */
+    std::atomic<int>    refcnt;     /* Each job using the copy */
+};
+
 struct ctx_stream_data {
-    u_char  *jpg_data;  /* Image compressed as JPG */
-    int     jpg_sz;     /* The number of bytes for jpg */
+    ctx_stream_jpg *jpg; /* Current jpg shared with the connections */
+    uint64_t enc_seq;   /* Last image sequence given to the encoder pool */
     int     consumed;   /* Bool for whether the jpeg data was consumed*/
     u_char  *img_data;  /* The base data used for image */
     int     jpg_cnct;   /* Counter of the number of jpg connections*/
@@ -143,11 +168,22 @@ struct ctx_stream_data {
 
 struct ctx_stream {
     pthread_mutex_t  mutex;
+    pthread_cond_t   cond;       /* Signaled when a new image is published (CLOCK_MONOTONIC) */
+    uint64_t         frame_seq;  /* Count of the images published */
+    struct timespec  frame_ts;   /* Time of the image last published */
+    ctx_stream_frame *enc_frame; /* Copy of the image being published */
+    int              enc_busy;   /* Jobs being compressed (encoder pool mutex) */
+    int64_t          enc_cnt;    /* Images compressed by the encoder pool */
+    int64_t          enc_drop;   /* Images dropped while the encoder pool was behind */
+    int64_t          enc_usec;   /* Average time from the camera to the jpg */
+    int64_t          enc_usec_max; /* Longest time from the camera to the jpg */
+    int              tile_dirty_cnt; /* Dirty tiles of the motion image published */
     ctx_stream_data  norm;       /* Copy of the image to use for web stream*/
     ctx_stream_data  sub;        /* Copy of the image to use for web stream*/
     ctx_stream_data  motion;     /* Copy of the image to use for web stream*/
     ctx_stream_data  source;     /* Copy of the image to use for web stream*/
     ctx_stream_data  secondary;  /* Copy of the image to use for web stream*/
+    std::vector<struct MHD_Connection*> wait_list; /* Suspended connections waiting for an image */
 };
 
 class cls_motapp {
@@ -177,6 +213,9 @@ class cls_motapp {
 
         pthread_mutex_t     mutex_camlst;       /* Lock the list of cams while adding/removing */
         pthread_mutex_t     mutex_post;         /* mutex to allow for processing of post actions*/
+        std::atomic<int>    decode_threads;     /* Decoder threads in use by all of the network cameras */
+        std::atomic<int>    netcam_starting;    /* Network cameras that are connecting for the first time */
+        cls_webu_jpgenc     *jpgenc;            /* Encoder pool for the jpg streams of all cameras */
 
         void signal_process();
         bool check_devices();
@@ -740,17 +740,10 @@ int cls_movie::put_frame(const struct timespec *ts1)
 
 }
 
-/* Reset the written flag and movie start time at opening of each event */
+/* Reset the written packet at opening of each event */
 void cls_movie::passthru_reset()
 {
-    int indx;
-
-    pthread_mutex_lock(&netcam_data->mutex_pktarray);
-        for(indx = 0; indx < netcam_data->pktarray_size; indx++) {
-            netcam_data->pktarray[indx].iswritten = false;
-        }
-    pthread_mutex_unlock(&netcam_data->mutex_pktarray);
-
+    pass_idnbr_written = 0;
 }
 
 int cls_movie::passthru_pktpts()
@@ -818,22 +811,14 @@ int cls_movie::passthru_pktpts()
     return 0;
 }
 
-void cls_movie::passthru_write(int indx)
+void cls_movie::passthru_write(AVPacket *src)
 {
-    /* Write the packet in the buffer at indx to file */
+    /* Write the packet to file */
     char errstr[128];
     int retcd;
 
     pkt = mypacket_alloc(pkt);
-    netcam_data->pktarray[indx].iswritten = true;
-
-    retcd = av_packet_ref(pkt, netcam_data->pktarray[indx].packet);
-    if (retcd < 0) {
-        av_strerror(retcd, errstr, sizeof(errstr));
-        MOTION_LOG(INF, TYPE_ENCODER, NO_ERRNO, "av_copy_packet: %s",errstr);
-        free_pkt();
-        return;
-    }
+    av_packet_move_ref(pkt, src);
 
     retcd = passthru_pktpts();
     if (retcd < 0) {
@@ -909,8 +894,9 @@ void cls_movie::passthru_minpts()
 
 int cls_movie::passthru_put(ctx_image_data *img_data)
 {
-    int64_t idnbr_image, idnbr_lastwritten, idnbr_stop, idnbr_firstkey;
-    int indx, indx_lastwritten, indx_firstkey, indx_video;
+    int64_t idnbr_image, idnbr_start;
+    int indx, cnt, pkt_cnt;
+    ctx_packet_item *item;
 
     if (netcam_data == nullptr) {
         return -1;
@@ -927,63 +913,66 @@ int cls_movie::passthru_put(ctx_image_data *img_data)
         idnbr_image = img_data->idnbr_norm;
     }
 
+    /*
+     * Only references to the packets are taken while holding the lock.
+     * The writing to the file is done after it is released so the
+     * camera is not held up by the disk.
+     */
+    pkt_cnt = 0;
     pthread_mutex_lock(&netcam_data->mutex_pktarray);
-        idnbr_lastwritten = 0;
-        idnbr_firstkey = idnbr_image;
-        idnbr_stop = 0;
-        indx_lastwritten = -1;
-        indx_firstkey = -1;
-        indx_video = netcam_data->video_stream_index;
-
-        for(indx = 0; indx < netcam_data->pktarray_size; indx++) {
-            if ((netcam_data->pktarray[indx].iswritten) &&
-                (netcam_data->pktarray[indx].idnbr > idnbr_lastwritten) &&
-                (netcam_data->pktarray[indx].packet->stream_index == indx_video)) {
-                idnbr_lastwritten=netcam_data->pktarray[indx].idnbr;
-                indx_lastwritten = indx;
-            }
-            if ((netcam_data->pktarray[indx].idnbr >  idnbr_stop) &&
-                (netcam_data->pktarray[indx].idnbr <= idnbr_image)&&
-                (netcam_data->pktarray[indx].packet->stream_index == indx_video)) {
-                idnbr_stop=netcam_data->pktarray[indx].idnbr;
-            }
-            if ((netcam_data->pktarray[indx].iskey) &&
-                (netcam_data->pktarray[indx].idnbr <= idnbr_firstkey)&&
-                (netcam_data->pktarray[indx].packet->stream_index == indx_video)) {
-                    idnbr_firstkey=netcam_data->pktarray[indx].idnbr;
-                    indx_firstkey = indx;
+        if (pass_idnbr_written >= idnbr_image) {
+            pthread_mutex_unlock(&netcam_data->mutex_pktarray);
+            return 0;
+        } else if (pass_idnbr_written > 0) {
+            idnbr_start = pass_idnbr_written + 1;
+        } else {
+            /* Begin at the key frame that starts the group of the image */
+            indx = netcam_data->pktarray_slot(idnbr_image);
+            if (indx == -1) {
+                pthread_mutex_unlock(&netcam_data->mutex_pktarray);
+                return 0;
             }
+            idnbr_start = netcam_data->pktarray[indx].idnbr_key;
         }
 
-        if (idnbr_stop == 0) {
+        indx = netcam_data->pktarray_slot(idnbr_start);
+        if (indx == -1) {
+            indx = netcam_data->pktarray_firstkey();
+        }
+        if (indx == -1) {
             pthread_mutex_unlock(&netcam_data->mutex_pktarray);
             return 0;
         }
 
-        if (indx_lastwritten != -1) {
-            indx = indx_lastwritten;
-        } else if (indx_firstkey != -1) {
-            indx = indx_firstkey;
-        } else {
-            indx = 0;
+        cnt = (int)(idnbr_image - netcam_data->pktarray[indx].idnbr + 1);
+        if (cnt > pass_pkts_size) {
+            pass_pkts =(AVPacket **)myrealloc(pass_pkts
+                , (uint)cnt * sizeof(AVPacket *), "passthru_put");
+            while (pass_pkts_size < cnt) {
+                pass_pkts[pass_pkts_size] = av_packet_alloc();
+                pass_pkts_size++;
+            }
         }
 
-        while (true){
-            if ((!netcam_data->pktarray[indx].iswritten) &&
-                (netcam_data->pktarray[indx].packet->size > 0) &&
-                (netcam_data->pktarray[indx].idnbr >  idnbr_lastwritten) &&
-                (netcam_data->pktarray[indx].idnbr <= idnbr_image)) {
-                passthru_write(indx);
-            }
-            if (netcam_data->pktarray[indx].idnbr == idnbr_stop) {
-                break;
+        while (cnt > 0) {
+            item = &netcam_data->pktarray[indx];
+            if ((item->packet->size > 0) &&
+                (av_packet_ref(pass_pkts[pkt_cnt], item->packet) >= 0)) {
+                pkt_cnt++;
             }
             indx++;
-            if (indx == netcam_data->pktarray_size ) {
+            if (indx == netcam_data->pktarray_size) {
                 indx = 0;
             }
+            cnt--;
         }
+        pass_idnbr_written = idnbr_image;
     pthread_mutex_unlock(&netcam_data->mutex_pktarray);
+
+    for (indx = 0; indx < pkt_cnt; indx++) {
+        passthru_write(pass_pkts[indx]);
+    }
+
     return 0;
 }
 
@@ -1725,6 +1714,7 @@ void cls_movie::init_vars()
     base_pts = 0;
     pass_audio_base = 0;
     pass_video_base = 0;
+    pass_idnbr_written = 0;
     test_mode = false;
     gop_cnt = 5;
     start_time.tv_nsec = 0;
@@ -1748,12 +1738,19 @@ cls_movie::cls_movie(cls_camera *p_cam, std::string pmovie_type)
     is_running = false;
 
     movie_type = pmovie_type;
+    pass_pkts = nullptr;
+    pass_pkts_size = 0;
 
     init_vars();
 }
 
 cls_movie::~cls_movie()
 {
+    int indx;
 
+    for (indx = 0; indx < pass_pkts_size; indx++) {
+        av_packet_free(&pass_pkts[indx]);
+    }
+    myfree(pass_pkts);
 }
 
@@ -372,7 +372,6 @@ void cls_netcam::pktarray_free()
 void cls_netcam::context_null()
 {
     swsctx          = nullptr;
-    swsframe_in     = nullptr;
     swsframe_out    = nullptr;
     frame           = nullptr;
     codec_context   = nullptr;
@@ -384,7 +383,6 @@ void cls_netcam::context_null()
 void cls_netcam::context_close()
 {
     if (swsctx          != nullptr) sws_freeContext(swsctx);
-    if (swsframe_in     != nullptr) av_frame_free(&swsframe_in);
     if (swsframe_out    != nullptr) av_frame_free(&swsframe_out);
     if (frame           != nullptr) av_frame_free(&frame);
     if (pktarray        != nullptr) pktarray_free();
@@ -392,6 +390,7 @@ void cls_netcam::context_close()
     if (format_context  != nullptr) avformat_close_input(&format_context);
     if (transfer_format != nullptr) avformat_close_input(&transfer_format);
     if (hw_device_ctx   != nullptr) av_buffer_unref(&hw_device_ctx);
+    decode_threads_release();
     context_null();
 }
 
@@ -443,14 +442,20 @@ void cls_netcam::pktarray_resize()
         if ((pktarray_size < newsize) ||  (pktarray_size < 30)) {
             tmp =(ctx_packet_item*) mymalloc((uint)newsize * sizeof(ctx_packet_item));
             if (pktarray_size > 0 ) {
-                memcpy(tmp, pktarray, sizeof(ctx_packet_item) * (uint)pktarray_size);
+                /* Unroll the ring so the packets stay in idnbr order */
+                indx = pktarray_index + 1;
+                memcpy(tmp, pktarray + indx
+                    , sizeof(ctx_packet_item) * (uint)(pktarray_size - indx));
+                memcpy(tmp + (pktarray_size - indx), pktarray
+                    , sizeof(ctx_packet_item) * (uint)indx);
+                pktarray_index = pktarray_size - 1;
             }
             for(indx = pktarray_size; indx < newsize; indx++) {
                 tmp[indx].packet = nullptr;
                 tmp[indx].packet = mypacket_alloc(tmp[indx].packet);
                 tmp[indx].idnbr = 0;
+                tmp[indx].idnbr_key = 0;
                 tmp[indx].iskey = false;
-                tmp[indx].iswritten = false;
             }
 
             myfree(pktarray);
@@ -464,6 +469,59 @@ void cls_netcam::pktarray_resize()
     pthread_mutex_unlock(&mutex_pktarray);
 }
 
+/*
+ * Index of the packet with the id number or -1 when it is no longer
+ * in the array.  The ids increase by one for each packet added so this
+ * is a direct lookup.  The caller holds mutex_pktarray.
+ */
+int cls_netcam::pktarray_slot(int64_t id)
+{
+    int64_t back;
+    int indx;
+
+    if ((pktarray_size == 0) || (pktarray_index < 0)) {
+        return -1;
+    }
+
+    back = pktarray[pktarray_index].idnbr - id;
+    if ((back < 0) || (back >= pktarray_size)) {
+        return -1;
+    }
+    indx = pktarray_index - (int)back;
+    if (indx < 0) {
+        indx += pktarray_size;
+    }
+    if (pktarray[indx].idnbr != id) {
+        return -1;
+    }
+
+    return indx;
+}
+
+/* Index of the oldest video key frame in the array.  The caller holds mutex_pktarray */
+int cls_netcam::pktarray_firstkey()
+{
+    int indx, cnt;
+
+    if ((pktarray_size == 0) || (pktarray_index < 0)) {
+        return -1;
+    }
+
+    indx = pktarray_index;
+    for (cnt = 0; cnt < pktarray_size; cnt++) {
+        indx++;
+        if (indx == pktarray_size) {
+            indx = 0;
+        }
+        if ((pktarray[indx].idnbr > 0) && (pktarray[indx].iskey) &&
+            (pktarray[indx].packet->stream_index == video_stream_index)) {
+            return indx;
+        }
+    }
+
+    return -1;
+}
+
 void cls_netcam::pktarray_add()
 {
     int indx_next;
@@ -486,10 +544,8 @@ void cls_netcam::pktarray_add()
 
         pktarray[indx_next].idnbr = idnbr;
 
-        av_packet_free(&pktarray[indx_next].packet);
-        pktarray[indx_next].packet = nullptr;
-        pktarray[indx_next].packet = mypacket_alloc(pktarray[indx_next].packet);
-
+        /* Reuse the packet of the slot.  Only the reference changes */
+        av_packet_unref(pktarray[indx_next].packet);
         retcd = av_packet_ref(pktarray[indx_next].packet, packet_recv);
         if ((interrupted) || (retcd < 0)) {
             av_strerror(retcd, errstr, sizeof(errstr));
@@ -497,16 +553,18 @@ void cls_netcam::pktarray_add()
                 ,_("%s:av_copy_packet:%s ,Interrupt:%s")
                 ,cameratype.c_str()
                 ,errstr, interrupted ? _("true"):_("false"));
-            av_packet_free(&pktarray[indx_next].packet);
-            pktarray[indx_next].packet = nullptr;
+            av_packet_unref(pktarray[indx_next].packet);
         }
 
         if (pktarray[indx_next].packet->flags & AV_PKT_FLAG_KEY) {
             pktarray[indx_next].iskey = true;
+            if (pktarray[indx_next].packet->stream_index == video_stream_index) {
+                pktarray_key = idnbr;
+            }
         } else {
             pktarray[indx_next].iskey = false;
         }
-        pktarray[indx_next].iswritten = false;
+        pktarray[indx_next].idnbr_key = pktarray_key;
 
         pktarray_index = indx_next;
     pthread_mutex_unlock(&mutex_pktarray);
@@ -683,6 +741,34 @@ int cls_netcam::decode_drm()
     return 1;
 }
 
+/*
+ * While the camera is not detecting motion, let the decoder discard
+ * the frames selected by the decode_idle param.  Coming back from
+ * keyframes only, the change waits for a keyframe so that the
+ * following frames have their references.
+ */
+void cls_netcam::decode_throttle()
+{
+    enum AVDiscard skip;
+
+    if (cam->detecting_motion) {
+        skip = AVDISCARD_DEFAULT;
+    } else {
+        skip = decode_idle;
+    }
+
+    if (codec_context->skip_frame == skip) {
+        return;
+    }
+
+    if ((codec_context->skip_frame == AVDISCARD_NONKEY) &&
+        ((packet_recv->flags & AV_PKT_FLAG_KEY) == 0)) {
+        return;
+    }
+
+    codec_context->skip_frame = skip;
+}
+
 int cls_netcam::decode_video()
 {
     int retcd;
@@ -697,6 +783,8 @@ int cls_netcam::decode_video()
         return 0;
     }
 
+    decode_throttle();
+
     retcd = avcodec_send_packet(codec_context, packet_recv);
     if ((interrupted) || (handler_stop)) {
         MOTION_LOG(INF, TYPE_NETCAM, NO_ERRNO
@@ -735,10 +823,83 @@ int cls_netcam::decode_video()
     return retcd;
 }
 
+void cls_netcam::decode_time(struct timespec *beg_tm, struct timespec *end_tm)
+{
+    int64_t usec;
+
+    usec = ((end_tm->tv_sec - beg_tm->tv_sec) * 1000000) +
+        ((end_tm->tv_nsec - beg_tm->tv_nsec) / 1000);
+    if (decode_usec == 0) {
+        decode_usec = usec;
+    } else {
+        decode_usec = ((decode_usec * 15) + usec) / 16;
+    }
+    if (usec > decode_usec_max) {
+        decode_usec_max = usec;
+    }
+}
+
+/*
+ * The camera clock is unknown so the gap between when an image arrives
+ * and when its PTS says it should have arrived is measured against the
+ * smallest gap seen on this connection.  This gives the delay added by
+ * buffering in the network, the demuxer and the decoder.
+ */
+void cls_netcam::ltncy_mark()
+{
+    int64_t pts, usec_pts, usec_arrive, gap;
+    AVRational tbase, usec_base = {1, 1000000};
+
+    pts = frame->pts;
+    if (pts == AV_NOPTS_VALUE) {
+        pts = packet_recv->pts;
+    }
+    tbase = format_context->streams[video_stream_index]->time_base;
+    usec_pts = av_rescale_q(pts - connection_pts, tbase, usec_base);
+    usec_arrive =
+        ((img_recv->image_time.tv_sec - connection_tm.tv_sec) * 1000000) +
+        ((img_recv->image_time.tv_nsec - connection_tm.tv_nsec) / 1000);
+
+    gap = usec_arrive - usec_pts;
+    if (gap < ltncy_base) {
+        ltncy_base = gap;
+    }
+    img_recv->ltncy = gap - ltncy_base;
+}
+
+/* Add the time the image waited for the camera thread and keep the average */
+void cls_netcam::ltncy_time()
+{
+    struct timespec curr_tm;
+    int64_t usec;
+
+    clock_gettime(CLOCK_MONOTONIC, &curr_tm);
+    usec = img_latest->ltncy +
+        ((curr_tm.tv_sec - img_latest->image_time.tv_sec) * 1000000) +
+        ((curr_tm.tv_nsec - img_latest->image_time.tv_nsec) / 1000);
+    if (ltncy_usec == 0) {
+        ltncy_usec = usec;
+    } else {
+        ltncy_usec = ((ltncy_usec * 15) + usec) / 16;
+    }
+    if (usec > ltncy_usec_max) {
+        ltncy_usec_max = usec;
+    }
+
+    if ((curr_tm.tv_sec - ltncy_log_tm.tv_sec) >= 600) {
+        MOTION_LOG(INF, TYPE_NETCAM, NO_ERRNO
+            ,_("%s:Latency average %ld ms, maximum %ld ms")
+            ,cameratype.c_str(), (long)(ltncy_usec / 1000)
+            , (long)(ltncy_usec_max / 1000));
+        ltncy_log_tm = curr_tm;
+    }
+}
+
 int cls_netcam::decode_packet()
 {
     int frame_size;
     int retcd;
+    struct timespec beg_tm, end_tm;
 
     if (handler_stop) {
         return -1;
@@ -750,16 +911,26 @@ int cls_netcam::decode_packet()
             ,cameratype.c_str());
     }
 
+    clock_gettime(CLOCK_MONOTONIC, &beg_tm);
     retcd = decode_video();
+    clock_gettime(CLOCK_MONOTONIC, &end_tm);
+    decode_time(&beg_tm, &end_tm);
     if (retcd <= 0) {
         return retcd;
     }
+
+    /* Images needing conversion are scaled from the frame planes in resize */
+    if ((imgsize.width  != frame->width) ||
+        (imgsize.height != frame->height) ||
+        (check_pixfmt() != 0)) {
+        return 1;
+    }
+
     frame_size = av_image_get_buffer_size(
         (enum AVPixelFormat) frame->format
         , frame->width, frame->height, 1);
 
     check_buffsize(img_recv, (uint)frame_size);
-    check_buffsize(img_latest, (uint)frame_size);
 
     retcd = av_image_copy_to_buffer(
         (uint8_t *)img_recv->ptr
@@ -1162,9 +1333,61 @@ int cls_netcam::init_swdecoder()
     codec_context->error_concealment = FF_EC_GUESS_MVS | FF_EC_DEBLOCK;
     codec_context->err_recognition = AV_EF_IGNORE_ERR;
 
+    decode_threads_set();
+
     return 0;
 }
 
+/*
+ * Give the software decoder its threads.  The netcam_decode_threads
+ * option is a budget shared by all of the network cameras.  Each
+ * decoder always gets at least one thread.
+ */
+void cls_netcam::decode_threads_set()
+{
+    int want, used, avail, budget;
+
+    want = cfg_thread_count;
+    if (want <= 0) {
+        want = (int)std::thread::hardware_concurrency();
+        if (want <= 0) {
+            want = 1;
+        }
+    }
+
+    budget = cam->app->cfg->netcam_decode_threads;
+    used = cam->app->decode_threads.load();
+    do {
+        decode_threads = want;
+        if (budget > 0) {
+            avail = budget - used;
+            if (decode_threads > avail) {
+                decode_threads = MAX(avail, 1);
+            }
+        }
+    } while (cam->app->decode_threads.compare_exchange_weak(
+        used, used + decode_threads) == false);
+
+    codec_context->thread_count = decode_threads;
+    if (cfg_thread_type == "frame") {
+        codec_context->thread_type = FF_THREAD_FRAME;
+    } else if (cfg_thread_type == "slice") {
+        codec_context->thread_type = FF_THREAD_SLICE;
+    }
+
+    MOTION_LOG(INF, TYPE_NETCAM, NO_ERRNO
+        ,_("%s:Decoding with %d of %d requested threads")
+        ,cameratype.c_str(), decode_threads, want);
+}
+
+void cls_netcam::decode_threads_release()
+{
+    if (decode_threads > 0) {
+        cam->app->decode_threads -= decode_threads;
+        decode_threads = 0;
+    }
+}
+
 int cls_netcam::open_codec()
 {
     int retcd;
@@ -1192,6 +1415,7 @@ int cls_netcam::open_codec()
     }
     video_stream_index = retcd;
     strm = format_context->streams[video_stream_index];
+    probe_apply();
 
     if (decoder_nm == "vaapi") {
         if (init_vaapi() < 0) {
@@ -1209,6 +1433,10 @@ int cls_netcam::open_codec()
         init_swdecoder();
     }
 
+    if (ltncy_low) {
+        codec_context->flags |= AV_CODEC_FLAG_LOW_DELAY;
+    }
+
     retcd = avcodec_open2(codec_context, decoder, nullptr);
     if ((retcd < 0) || (interrupted)) {
         decoder_error(retcd, "avcodec_open2");
@@ -1227,17 +1455,6 @@ int cls_netcam::open_sws()
         return -1;
     }
 
-    swsframe_in = av_frame_alloc();
-    if (swsframe_in == nullptr) {
-        if (status == NETCAM_NOTCONNECTED) {
-            MOTION_LOG(ERR, TYPE_NETCAM, NO_ERRNO
-                , _("%s:Unable to allocate swsframe_in.")
-                , cameratype.c_str());
-        }
-        context_close();
-        return -1;
-    }
-
     swsframe_out = av_frame_alloc();
     if (swsframe_out == nullptr) {
         if (status == NETCAM_NOTCONNECTED) {
@@ -1291,10 +1508,6 @@ int cls_netcam::open_sws()
         return -1;
     }
 
-    /* the image buffers must be big enough to hold the final frame after resizing */
-    check_buffsize(img_recv, (uint)swsframe_size);
-    check_buffsize(img_latest, (uint)swsframe_size);
-
     return 0;
 }
 
@@ -1302,7 +1515,6 @@ int cls_netcam::resize()
 {
     int      retcd;
     char     errstr[128];
-    uint8_t *buffer_out;
 
     if (handler_stop) {
         return -1;
@@ -1313,29 +1525,15 @@ int cls_netcam::resize()
             return -1;
         }
     }
-    retcd = av_image_fill_arrays(
-        swsframe_in->data
-        , swsframe_in->linesize
-        , (uint8_t*)img_recv->ptr
-        , (enum AVPixelFormat)frame->format
-        , frame->width, frame->height, 1);
-    if (retcd < 0) {
-        if (status == NETCAM_NOTCONNECTED) {
-            av_strerror(retcd, errstr, sizeof(errstr));
-            MOTION_LOG(ERR, TYPE_NETCAM, NO_ERRNO
-                ,_("%s:Error allocating picture in:%s")
-                , cameratype.c_str(), errstr);
-        }
-        context_close();
-        return -1;
-    }
 
-    buffer_out=(uint8_t *)av_malloc((uint)swsframe_size*sizeof(uint8_t));
+    /* The image buffer must be big enough to hold the final frame after resizing */
+    img_recv->used = 0;
+    check_buffsize(img_recv, (uint)swsframe_size);
 
     retcd = av_image_fill_arrays(
         swsframe_out->data
         , swsframe_out->linesize
-        , buffer_out, AV_PIX_FMT_YUV420P
+        , (uint8_t*)img_recv->ptr, AV_PIX_FMT_YUV420P
         , imgsize.width, imgsize.height, 1);
     if (retcd < 0) {
         if (status == NETCAM_NOTCONNECTED) {
@@ -1348,10 +1546,11 @@ int cls_netcam::resize()
         return -1;
     }
 
+    /* Scale from the planes of the decoded frame straight into the image buffer */
     retcd = sws_scale(
         swsctx
-        ,(const uint8_t* const *)swsframe_in->data
-        ,swsframe_in->linesize
+        ,(const uint8_t* const *)frame->data
+        ,frame->linesize
         ,0
         ,frame->height
         ,swsframe_out->data
@@ -1366,28 +1565,8 @@ int cls_netcam::resize()
         context_close();
         return -1;
     }
-
-    retcd = av_image_copy_to_buffer(
-        (uint8_t *)img_recv->ptr
-        , swsframe_size
-        , (const uint8_t * const*)swsframe_out
-        , swsframe_out->linesize
-        , AV_PIX_FMT_YUV420P
-        , imgsize.width, imgsize.height, 1);
-    if (retcd < 0) {
-        if (status == NETCAM_NOTCONNECTED) {
-            av_strerror(retcd, errstr, sizeof(errstr));
-            MOTION_LOG(ERR, TYPE_NETCAM, NO_ERRNO
-                ,_("%s:Error putting frame into output buffer:%s")
-                , cameratype.c_str(), errstr);
-        }
-        context_close();
-        return -1;
-    }
     img_recv->used = (uint)swsframe_size;
 
-    av_free(buffer_out);
-
     return 0;
 }
 
@@ -1404,6 +1583,7 @@ void cls_netcam::pkt_ts()
             connection_pts = packet_recv->pts;
         }
         clock_gettime(CLOCK_MONOTONIC, &connection_tm);
+        ltncy_base = INT64_MAX;
     }
 
     if (packet_recv->pts == AV_NOPTS_VALUE) {
@@ -1440,7 +1620,6 @@ int cls_netcam::read_image()
     int  size_decoded, retcd, errcnt, nodata;
     bool haveimage;
     char errstr[128];
-    netcam_buff *xchg;
 
     if (handler_stop) {
         return -1;
@@ -1496,6 +1675,15 @@ int cls_netcam::read_image()
                 haveimage = true;
             } else if (size_decoded == 0) {
                 /* Did not fail, just didn't get anything.  Try again */
+                if (passthrough &&
+                    (packet_recv->stream_index == video_stream_index) &&
+                    (packet_recv->data != nullptr)) {
+                    /* Keep the packets of frames not decoded for the movie */
+                    pthread_mutex_lock(&mutex);
+                        idnbr++;
+                        pktarray_add();
+                    pthread_mutex_unlock(&mutex);
+                }
                 free_pkt();
                 packet_recv = mypacket_alloc(packet_recv);
 
@@ -1543,14 +1731,15 @@ int cls_netcam::read_image()
         if (passthrough) {
             pktarray_add();
         }
-        if (!(high_resolution && passthrough) &&
-            (packet_recv->stream_index == video_stream_index)) {
-            xchg = img_latest;
-            img_latest = img_recv;
-            img_recv = xchg;
-        }
     pthread_mutex_unlock(&mutex);
 
+    if (!(high_resolution && passthrough) &&
+        (packet_recv->stream_index == video_stream_index)) {
+        ltncy_mark();
+        img_recv->idnbr = idnbr;
+        queue_push();
+    }
+
     clock_gettime(CLOCK_MONOTONIC, &ist_tm);
     free_pkt();
 
@@ -1655,11 +1844,30 @@ void cls_netcam::set_options()
         util_parms_add_default(params,"input_format","");
     }
 
+    if (ltncy_low) {
+        util_parms_add_default(params,"fflags","nobuffer");
+        util_parms_add_default(params,"probesize","32768");
+        util_parms_add_default(params,"analyzeduration","500000");
+        util_parms_add_default(params,"max_delay","100000");
+        if ((service == "rtsp") || (service == "rtsps")) {
+            util_parms_add_default(params,"reorder_queue_size","0");
+        }
+    }
+
     for (indx=0;indx<params->params_cnt;indx++) {
         itm = &params->params_array[indx];
         if ((itm->param_name != "decoder") &&
             (itm->param_name != "capture_rate") &&
             (itm->param_name != "interrupt") &&
+            (itm->param_name != "queue_policy") &&
+            (itm->param_name != "queue_size") &&
+            (itm->param_name != "decode_idle") &&
+            (itm->param_name != "thread_count") &&
+            (itm->param_name != "thread_type") &&
+            (itm->param_name != "reconnect_min") &&
+            (itm->param_name != "reconnect_max") &&
+            (itm->param_name != "latency_profile") &&
+            (itm->param_name != "probe_cache") &&
             (itm->param_name != "input_format")) {
             av_dict_set(&opts
                 , itm->param_name.c_str(), itm->param_value.c_str(), 0);
@@ -1686,6 +1894,7 @@ void cls_netcam::set_path ()
     ctx_url url;
 
     path = "";
+    probe_url = "";
 
     if (high_resolution) {
         url_parse(&url, cam->cfg->netcam_high_url);
@@ -1699,6 +1908,7 @@ void cls_netcam::set_path ()
 
     if  (url.service == "v4l2") {
         path = url.path;
+        probe_url = path;
         MOTION_LOG(INF, TYPE_NETCAM, NO_ERRNO
             ,_("Setting up v4l2"));
     } else if (url.service == "file") {
@@ -1709,13 +1919,14 @@ void cls_netcam::set_path ()
     } else {
         MOTION_LOG(INF, TYPE_NETCAM, NO_ERRNO
             ,_("Setting up %s "),url.service.c_str());
+        probe_url = url.service + "://" +
+            url.host + ":" + std::to_string(url.port) + url.path;
         if (url.userpass.length() > 0) {
             path = url.service + "://" +
                 url.userpass + "@" + url.host +":"+
                 std::to_string(url.port) + url.path;
         } else {
-            path = url.service + "://" +
-                url.host + ":" + std::to_string(url.port) + url.path;
+            path = probe_url;
         }
     }
 
@@ -1725,6 +1936,7 @@ void cls_netcam::set_path ()
 void cls_netcam::set_parms ()
 {
     int indx;
+    size_t lstpos;
 
     params = new ctx_params;
 
@@ -1764,12 +1976,9 @@ void cls_netcam::set_parms ()
 
     status = NETCAM_NOTCONNECTED;
     util_parms_add_default(params,"decoder","DEFAULT");
-    img_recv =(netcam_buff_ptr) mymalloc(sizeof(netcam_buff));
-    img_recv->ptr =(char*) mymalloc(NETCAM_BUFFSIZE);
-    img_latest =(netcam_buff_ptr) mymalloc(sizeof(netcam_buff));
-    img_latest->ptr =(char*) mymalloc(NETCAM_BUFFSIZE);
     pktarray_size = 0;
     pktarray_index = -1;
+    pktarray_key = 0;
     pktarray = nullptr;
     packet_recv = nullptr;
     first_image = true;
@@ -1792,6 +2001,15 @@ void cls_netcam::set_parms ()
     filelist.clear();
     filedir = "";
     cfg_idur = 3;
+    cfg_thread_count = 1;
+    cfg_thread_type = "";
+    queue_policy = NETCAM_QUEUE_LATEST;
+    queue_size = 4;
+    decode_idle = AVDISCARD_DEFAULT;
+    reconnect_min = 1;
+    reconnect_max = 60;
+    ltncy_low = false;
+    probe_cache = false;
 
     for (indx=0;indx<params->params_cnt;indx++) {
         if (params->params_array[indx].param_name == "decoder") {
@@ -1807,11 +2025,61 @@ void cls_netcam::set_parms ()
         if (params->params_array[indx].param_name == "interrupt") {
             cfg_idur = mtoi(params->params_array[indx].param_value);
         }
+        if (params->params_array[indx].param_name == "queue_policy") {
+            if (params->params_array[indx].param_value == "drain") {
+                queue_policy = NETCAM_QUEUE_DRAIN;
+            }
+        }
+        if (params->params_array[indx].param_name == "queue_size") {
+            queue_size = mtoi(params->params_array[indx].param_value);
+        }
+        if (params->params_array[indx].param_name == "thread_count") {
+            cfg_thread_count = mtoi(params->params_array[indx].param_value);
+        }
+        if (params->params_array[indx].param_name == "thread_type") {
+            cfg_thread_type = params->params_array[indx].param_value;
+        }
+        if (params->params_array[indx].param_name == "decode_idle") {
+            if (params->params_array[indx].param_value == "nonref") {
+                decode_idle = AVDISCARD_NONREF;
+            } else if (params->params_array[indx].param_value == "nonkey") {
+                decode_idle = AVDISCARD_NONKEY;
+            }
+        }
+        if (params->params_array[indx].param_name == "probe_cache") {
+            probe_cache = mtob(params->params_array[indx].param_value);
+        }
+        if (params->params_array[indx].param_name == "latency_profile") {
+            if (params->params_array[indx].param_value == "low") {
+                ltncy_low = true;
+            }
+        }
+        if (params->params_array[indx].param_name == "reconnect_min") {
+            reconnect_min = mtoi(params->params_array[indx].param_value);
+        }
+        if (params->params_array[indx].param_name == "reconnect_max") {
+            reconnect_max = mtoi(params->params_array[indx].param_value);
+        }
     }
 
+    /* Frame threads each hold back a frame so use slices for low latency */
+    if ((ltncy_low == true) && (cfg_thread_type == "")) {
+        cfg_thread_type = "slice";
+    }
+
+    if (reconnect_min < 1) {
+        reconnect_min = 1;
+    }
+    if (reconnect_max < reconnect_min) {
+        reconnect_max = reconnect_min;
+    }
+
+    queue_init();
+
     /* If this is the norm and we have a highres, then disable passthru on the norm */
     if ((high_resolution == false) &&
-        (cam->cfg->netcam_high_url != "")) {
+        (cam->cfg->netcam_high_url != "") &&
+        (cam->netcam_shared == false)) {
         passthrough = false;
     } else {
         passthrough = cam->movie_passthrough;
@@ -1828,6 +2096,19 @@ void cls_netcam::set_parms ()
     interrupted = false;
 
     set_path();
+
+    /* The probe is kept next to the config file rather than with the media */
+    lstpos = cam->conf_src->conf_filename.find_last_of("/");
+    if (probe_cache && (lstpos != std::string::npos)) {
+        probe_file = cam->conf_src->conf_filename.substr(0, lstpos) +
+            "/.netcam_" + std::to_string(cam->cfg->device_id) +
+            (high_resolution ? "_high" : "_norm") + ".probe";
+    } else {
+        probe_file = "";
+    }
+    if (probe_cache) {
+        probe_load();
+    }
 }
 
 /* Make a static copy of the stream information for use in passthrough processing */
@@ -1864,10 +2145,237 @@ int cls_netcam::copy_stream()
     return 0;
 }
 
+/*
+ * The values from a successful probe are kept with the camera and in
+ * the probe_file so that the next connection can use a short probe.
+ * Anything the short probe does not find is filled from these values.
+ */
+void cls_netcam::probe_load()
+{
+    std::ifstream ifs;
+    std::string line, parm_nm, parm_vl;
+    size_t stpos;
+    ctx_netcam_probe tmp;
+
+    if ((probe_cache == false) || (probe.have == true) ||
+        (probe_file == "")) {
+        return;
+    }
+
+    ifs.open(probe_file.c_str());
+    if (ifs.is_open() == false) {
+        return;
+    }
+
+    tmp.have = false;
+    tmp.codec_id = -1;
+    tmp.width = 0;
+    tmp.height = 0;
+    tmp.pix_fmt = -1;
+    tmp.fps_num = 0;
+    tmp.fps_den = 1;
+    while (std::getline(ifs, line)) {
+        stpos = line.find("=");
+        if ((stpos == std::string::npos) || (stpos == 0)) {
+            continue;
+        }
+        parm_nm = line.substr(0, stpos);
+        parm_vl = line.substr(stpos + 1);
+        if (parm_nm == "url") {
+            tmp.url = parm_vl;
+        } else if (parm_nm == "codec_id") {
+            tmp.codec_id = mtoi(parm_vl);
+        } else if (parm_nm == "width") {
+            tmp.width = mtoi(parm_vl);
+        } else if (parm_nm == "height") {
+            tmp.height = mtoi(parm_vl);
+        } else if (parm_nm == "pix_fmt") {
+            tmp.pix_fmt = mtoi(parm_vl);
+        } else if (parm_nm == "fps_num") {
+            tmp.fps_num = mtoi(parm_vl);
+        } else if (parm_nm == "fps_den") {
+            tmp.fps_den = mtoi(parm_vl);
+        } else if (parm_nm == "extradata") {
+            tmp.extradata = parm_vl;
+        }
+    }
+    ifs.close();
+
+    if ((tmp.url != probe_url) || (tmp.codec_id <= 0) ||
+        (tmp.width <= 0) || (tmp.height <= 0) ||
+        (tmp.fps_den <= 0) || ((tmp.extradata.length() % 2) != 0)) {
+        MOTION_LOG(INF, TYPE_NETCAM, NO_ERRNO
+            ,_("%s:Ignoring the stream probe in %s")
+            ,cameratype.c_str(), probe_file.c_str());
+        return;
+    }
+
+    tmp.have = true;
+    probe = tmp;
+}
+
+void cls_netcam::probe_save()
+{
+    AVCodecParameters *par;
+    ctx_netcam_probe tmp;
+    FILE *fp;
+    char hex[3];
+    int indx, fd;
+
+    if (probe_cache == false) {
+        return;
+    }
+
+    par = strm->codecpar;
+    tmp.have = true;
+    tmp.url = probe_url;
+    tmp.codec_id = (int)par->codec_id;
+    tmp.width = par->width;
+    tmp.height = par->height;
+    tmp.pix_fmt = par->format;
+    tmp.fps_num = strm->avg_frame_rate.num;
+    tmp.fps_den = strm->avg_frame_rate.den;
+    tmp.extradata = "";
+    for (indx=0; indx<par->extradata_size; indx++) {
+        snprintf(hex, sizeof(hex), "%02x", par->extradata[indx]);
+        tmp.extradata += hex;
+    }
+
+    if ((tmp.width <= 0) || (tmp.height <= 0) || (tmp.fps_den <= 0)) {
+        return;
+    }
+
+    if ((probe.have == true) &&
+        (probe.url == tmp.url) &&
+        (probe.codec_id == tmp.codec_id) &&
+        (probe.width == tmp.width) &&
+        (probe.height == tmp.height) &&
+        (probe.pix_fmt == tmp.pix_fmt) &&
+        (probe.fps_num == tmp.fps_num) &&
+        (probe.fps_den == tmp.fps_den) &&
+        (probe.extradata == tmp.extradata)) {
+        return;
+    }
+    probe = tmp;
+
+    if (probe_file == "") {
+        return;
+    }
+
+    /* Only the user running Motion may read the file */
+    fp = nullptr;
+    fd = open(probe_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (fd != -1) {
+        if (fchmod(fd, S_IRUSR | S_IWUSR) == 0) {
+            fp = fdopen(fd, "w");
+        }
+        if (fp == nullptr) {
+            close(fd);
+        }
+    }
+    if (fp == nullptr) {
+        MOTION_LOG(WRN, TYPE_NETCAM, SHOW_ERRNO
+            ,_("%s:Unable to save the stream probe to %s")
+            ,cameratype.c_str(), probe_file.c_str());
+        return;
+    }
+    fprintf(fp, "url=%s\n", probe.url.c_str());
+    fprintf(fp, "codec_id=%d\n", probe.codec_id);
+    fprintf(fp, "width=%d\n", probe.width);
+    fprintf(fp, "height=%d\n", probe.height);
+    fprintf(fp, "pix_fmt=%d\n", probe.pix_fmt);
+    fprintf(fp, "fps_num=%d\n", probe.fps_num);
+    fprintf(fp, "fps_den=%d\n", probe.fps_den);
+    fprintf(fp, "extradata=%s\n", probe.extradata.c_str());
+    myfclose(fp);
+}
+
+/* With a cached probe only a short probe is done unless the params say otherwise */
+void cls_netcam::probe_opts()
+{
+    int indx;
+    bool has_size, has_dur, has_fps;
+
+    if ((probe_cache == false) || (probe.have == false) ||
+        (probe.url != probe_url)) {
+        return;
+    }
+
+    has_size = false;
+    has_dur = false;
+    has_fps = false;
+    for (indx=0;indx<params->params_cnt;indx++) {
+        if (params->params_array[indx].param_name == "probesize") {
+            has_size = true;
+        } else if (params->params_array[indx].param_name == "analyzeduration") {
+            has_dur = true;
+        } else if (params->params_array[indx].param_name == "fpsprobesize") {
+            has_fps = true;
+        }
+    }
+    if (has_size == false) {
+        av_dict_set(&opts, "probesize", "32768", 0);
+    }
+    if (has_dur == false) {
+        av_dict_set(&opts, "analyzeduration", "100000", 0);
+    }
+    if (has_fps == false) {
+        av_dict_set(&opts, "fpsprobesize", "0", 0);
+    }
+}
+
+/* Fill in what the short probe did not find */
+void cls_netcam::probe_apply()
+{
+    AVCodecParameters *par;
+    int indx, len;
+    uint hexval;
+
+    if ((probe_cache == false) || (probe.have == false)) {
+        return;
+    }
+
+    par = strm->codecpar;
+    if ((probe.url != probe_url) || ((int)par->codec_id != probe.codec_id)) {
+        MOTION_LOG(INF, TYPE_NETCAM, NO_ERRNO
+            ,_("%s:Stream does not match the cached probe")
+            ,cameratype.c_str());
+        probe.have = false;
+        return;
+    }
+
+    if (par->width <= 0) {
+        par->width = probe.width;
+    }
+    if (par->height <= 0) {
+        par->height = probe.height;
+    }
+    if (par->format < 0) {
+        par->format = probe.pix_fmt;
+    }
+    if ((strm->avg_frame_rate.num <= 0) || (strm->avg_frame_rate.den <= 0)) {
+        strm->avg_frame_rate.num = probe.fps_num;
+        strm->avg_frame_rate.den = probe.fps_den;
+    }
+    if ((par->extradata == nullptr) && (probe.extradata != "")) {
+        len = (int)probe.extradata.length() / 2;
+        par->extradata = (uint8_t*)av_mallocz(
+            (size_t)len + AV_INPUT_BUFFER_PADDING_SIZE);
+        if (par->extradata != nullptr) {
+            for (indx=0; indx<len; indx++) {
+                sscanf(probe.extradata.c_str() + (indx * 2), "%2x", &hexval);
+                par->extradata[indx] = (uint8_t)hexval;
+            }
+            par->extradata_size = len;
+        }
+    }
+}
+
 int cls_netcam::open_context()
 {
     int  retcd;
     char errstr[128];
+    struct timespec probe_tm;
 
     if (handler_stop) {
         return -1;
@@ -1891,6 +2399,7 @@ int cls_netcam::open_context()
     idur = cfg_idur * 3; /*3 is arbritrary multiplier to give connect more time than other steps*/
 
     set_options();
+    probe_opts();
 
     MOTION_LOG(DBG, TYPE_NETCAM, NO_ERRNO, _("Opening camera"));
     retcd = avformat_open_input(&format_context
@@ -1923,7 +2432,14 @@ int cls_netcam::open_context()
 
     /* fill out stream information */
     retcd = avformat_find_stream_info(format_context, nullptr);
+    clock_gettime(CLOCK_MONOTONIC, &probe_tm);
+    MOTION_LOG(INF, TYPE_NETCAM, NO_ERRNO
+        ,_("%s:Stream probe took %ld ms")
+        ,cameratype.c_str()
+        ,(long)(((probe_tm.tv_sec - ist_tm.tv_sec) * 1000) +
+            ((probe_tm.tv_nsec - ist_tm.tv_nsec) / 1000000)));
     if ((retcd < 0) || (interrupted) || (handler_stop) ) {
+        probe.have = false;
         if (status == NETCAM_NOTCONNECTED) {
             if (retcd < 0) {
                 av_strerror(retcd, errstr, sizeof(errstr));
@@ -1950,6 +2466,7 @@ int cls_netcam::open_context()
         retcd = open_codec();
     mythreadname_set(nullptr, 0, threadname.c_str());
     if ((retcd < 0) || (interrupted) || (handler_stop) ) {
+        probe.have = false;
         if (status == NETCAM_NOTCONNECTED) {
             MOTION_LOG(ERR, TYPE_NETCAM, NO_ERRNO
                 ,_("%s:Unable to open codec context")
@@ -2014,6 +2531,8 @@ int cls_netcam::open_context()
         return -1;
     }
 
+    probe_save();
+
     return 0;
 }
 
@@ -2119,9 +2638,61 @@ void cls_netcam::handler_wait()
     }
 }
 
+/*
+ * Wait before the next reconnect.  The wait starts at reconnect_min
+ * seconds and doubles with each failure up to reconnect_max.  Each wait
+ * is moved by up to a quarter either way so that cameras which were all
+ * lost at once (e.g. a switch reboot) do not all try again at once.
+ * Returns the wait in milliseconds.
+ */
+int cls_netcam::reconnect_backoff()
+{
+    int64_t slp_ms, jitter;
+    int shift;
+
+    shift = reconnect_count;
+    if (shift > 20) {
+        shift = 20;
+    }
+    slp_ms = ((int64_t)reconnect_min * 1000) << shift;
+    if (slp_ms > ((int64_t)reconnect_max * 1000)) {
+        slp_ms = (int64_t)reconnect_max * 1000;
+    }
+    jitter = slp_ms / 4;
+    if (jitter > 0) {
+        slp_ms += (int64_t)(rand_r(&reconnect_seed) % (2 * jitter + 1)) - jitter;
+    }
+    if (reconnect_count < 1000) {
+        reconnect_count++;
+    }
+
+    return (int)slp_ms;
+}
+
+/* The camera is back.  Record how long it was lost and reset the wait */
+void cls_netcam::reconnect_done()
+{
+    struct timespec tmp_tm;
+
+    if (lost_tm.tv_sec != 0) {
+        clock_gettime(CLOCK_MONOTONIC, &tmp_tm);
+        reconnect_msec =
+            ((tmp_tm.tv_sec - lost_tm.tv_sec) * 1000) +
+            ((tmp_tm.tv_nsec - lost_tm.tv_nsec) / 1000000);
+        reconnect_success++;
+        MOTION_LOG(NTC, TYPE_NETCAM, NO_ERRNO
+            ,_("%s:Camera reconnected after %d attempts in %.1f seconds")
+            ,cameratype.c_str(), reconnect_count + 1
+            ,(double)reconnect_msec / 1000.0);
+        lost_tm.tv_sec = 0;
+        lost_tm.tv_nsec = 0;
+    }
+    reconnect_count = 0;
+}
+
 void cls_netcam::handler_reconnect()
 {
-    int retcd, slp_dur;
+    int slp_ms;
 
     if (service == "file") {
         filelist_load();
@@ -2133,6 +2704,9 @@ void cls_netcam::handler_reconnect()
         MOTION_LOG(NTC, TYPE_NETCAM, NO_ERRNO
             ,_("%s:Reconnecting with camera....")
             ,cameratype.c_str());
+        if (lost_tm.tv_sec == 0) {
+            clock_gettime(CLOCK_MONOTONIC, &lost_tm);
+        }
     }
     status = NETCAM_RECONNECTING;
 
@@ -2140,50 +2714,30 @@ void cls_netcam::handler_reconnect()
         cam->event_stop = true;
     }
 
-    retcd = connect();
-    if (retcd < 0) {
-        if (reconnect_count < 100) {
-            reconnect_count++;
-        } else {
-            if (reconnect_count >= 500) {
-                MOTION_LOG(NTC, TYPE_NETCAM, NO_ERRNO
-                    ,_("%s:Camera did not reconnect.")
-                    , cameratype.c_str());
-                MOTION_LOG(NTC, TYPE_NETCAM, NO_ERRNO
-                    ,_("%s:Checking for camera every 2 hours.")
-                    ,cameratype.c_str());
-                slp_dur = 7200;
-            } else if (reconnect_count >= 200) {
-                MOTION_LOG(NTC, TYPE_NETCAM, NO_ERRNO
-                    ,_("%s:Camera did not reconnect.")
-                    , cameratype.c_str());
-                MOTION_LOG(NTC, TYPE_NETCAM, NO_ERRNO
-                    ,_("%s:Checking for camera every 10 minutes.")
-                    ,cameratype.c_str());
-                reconnect_count++;
-                slp_dur = 600;
-            } else {
-                MOTION_LOG(NTC, TYPE_NETCAM, NO_ERRNO
-                    ,_("%s:Camera did not reconnect.")
-                    , cameratype.c_str());
-                MOTION_LOG(NTC, TYPE_NETCAM, NO_ERRNO
-                    ,_("%s:Checking for camera every 10 seconds.")
-                    ,cameratype.c_str());
-                reconnect_count++;
-                slp_dur = 10;
-            }
-            cam->watchdog = slp_dur + (cam->cfg->watchdog_tmo * 3);
+    if (lost_tm.tv_sec != 0) {
+        reconnect_attempts++;
+    }
 
-            while ((cam->handler_stop == false) && (slp_dur > 0)) {
-                SLEEP(1, 0);
-                slp_dur--;
-            }
+    if (connect() < 0) {
+        if (lost_tm.tv_sec == 0) {
+            clock_gettime(CLOCK_MONOTONIC, &lost_tm);
+        }
+        slp_ms = reconnect_backoff();
+        MOTION_LOG(NTC, TYPE_NETCAM, NO_ERRNO
+            ,_("%s:Camera did not reconnect.  Trying again in %.1f seconds.")
+            ,cameratype.c_str(), (double)slp_ms / 1000.0);
 
-            cam->watchdog = (cam->cfg->watchdog_tmo * 3);
+        cam->watchdog = (slp_ms / 1000) + (cam->cfg->watchdog_tmo * 3);
 
+        while ((cam->handler_stop == false) &&
+            (handler_stop == false) && (slp_ms > 0)) {
+            SLEEP(0, 100000000L);
+            slp_ms -= 100;
         }
+
+        cam->watchdog = (cam->cfg->watchdog_tmo * 3);
     } else {
-        reconnect_count = 0;
+        reconnect_done();
     }
 }
 
@@ -2314,17 +2868,21 @@ void cls_netcam::handler_shutdown()
 
     context_close();
 
-    if (img_latest != nullptr) {
-        myfree(img_latest->ptr);
-        myfree(img_latest);
-        img_latest = nullptr;
+    MOTION_LOG(INF, TYPE_NETCAM, NO_ERRNO
+        ,_("%s:Decode time average %ld us, maximum %ld us")
+        ,cameratype.c_str(), (long)decode_usec, (long)decode_usec_max);
+    MOTION_LOG(INF, TYPE_NETCAM, NO_ERRNO
+        ,_("%s:Latency average %ld ms, maximum %ld ms")
+        ,cameratype.c_str(), (long)(ltncy_usec / 1000)
+        , (long)(ltncy_usec_max / 1000));
+    if (reconnect_attempts > 0) {
+        MOTION_LOG(INF, TYPE_NETCAM, NO_ERRNO
+            ,_("%s:Reconnect attempts %u, reconnected %u times, last took %ld ms")
+            ,cameratype.c_str(), (uint)reconnect_attempts
+            ,(uint)reconnect_success, (long)reconnect_msec);
     }
 
-    if (img_recv != nullptr) {
-        myfree(img_recv->ptr);
-        myfree(img_recv);
-        img_recv   = nullptr;
-    }
+    queue_free();
 
     mydelete(params);
 
@@ -2336,14 +2894,79 @@ void cls_netcam::handler_shutdown()
 
 }
 
+/*
+ * Only netcam_start_max cameras connect at once so that starting many
+ * cameras does not swamp the network and the processors.
+ */
+bool cls_netcam::start_wait()
+{
+    int limit, used;
+    bool logged;
+
+    start_held = false;
+    limit = cam->app->cfg->netcam_start_max;
+    if (limit == 0) {
+        return true;
+    }
+
+    logged = false;
+    while (cam->handler_stop == false) {
+        used = cam->app->netcam_starting.load();
+        if ((used < limit) &&
+            (cam->app->netcam_starting.compare_exchange_weak(used, used + 1))) {
+            start_held = true;
+            return true;
+        }
+        if (logged == false) {
+            MOTION_LOG(INF, TYPE_NETCAM, NO_ERRNO
+                ,_("Waiting for other network cameras to start"));
+            logged = true;
+        }
+        cam->watchdog = cam->cfg->watchdog_tmo * 3;
+        SLEEP(0, 100000000L);
+    }
+
+    return false;
+}
+
+void cls_netcam::start_release()
+{
+    if (start_held) {
+        cam->app->netcam_starting--;
+        start_held = false;
+    }
+}
+
 void cls_netcam::netcam_start()
 {
-    int retcd;
+    struct timespec beg_tm, end_tm;
 
     if (cam->handler_stop == true) {
         return;
     }
 
+    clock_gettime(CLOCK_MONOTONIC, &beg_tm);
+
+    if (start_wait() == false) {
+        return;
+    }
+    start_open();
+    start_release();
+
+    if (handler_running == true) {
+        clock_gettime(CLOCK_MONOTONIC, &end_tm);
+        start_msec = ((end_tm.tv_sec - beg_tm.tv_sec) * 1000) +
+            ((end_tm.tv_nsec - beg_tm.tv_nsec) / 1000000);
+        MOTION_LOG(NTC, TYPE_NETCAM, NO_ERRNO
+            ,_("%s:First image %.1f seconds after starting")
+            ,cameratype.c_str(), (double)start_msec / 1000.0);
+    }
+}
+
+void cls_netcam::start_open()
+{
+    int retcd;
+
     handler_running = false;
     handler_stop = false;
 
@@ -2378,6 +3001,7 @@ void cls_netcam::netcam_start()
         handler_shutdown();
         return;
     }
+    reconnect_done();
     cam->watchdog = cam->cfg->watchdog_tmo * 3; /* 3 is arbitrary multiplier to give startup more time*/
     /* When running dual, there seems to be contamination across norm/high with codec functions. */
     context_close();       /* Close in this thread to open it again within handler thread */
@@ -2400,43 +3024,213 @@ void cls_netcam::netcam_stop()
     handler_shutdown();
 }
 
+/*
+ * Called by the camera thread while the handler is not running.  The
+ * camera thread keeps going with the grey image and the restart is
+ * only tried once the wait from reconnect_backoff has passed.
+ */
 void cls_netcam::noimage()
 {
-    int slp_dur;
-
-    if (handler_running == false ) {
-        if (reconnect_count >= 500) {
-            MOTION_LOG(NTC, TYPE_NETCAM, NO_ERRNO,_("Camera did not reconnect."));
-            MOTION_LOG(NTC, TYPE_NETCAM, NO_ERRNO,_("Checking for camera every 2 hours."));
-            slp_dur = 7200;
-        } else if (reconnect_count >= 200) {
-            MOTION_LOG(NTC, TYPE_NETCAM, NO_ERRNO,_("Camera did not reconnect."));
-            MOTION_LOG(NTC, TYPE_NETCAM, NO_ERRNO,_("Checking for camera every 10 minutes."));
-            reconnect_count++;
-            slp_dur = 600;
-        } else {
-            MOTION_LOG(NTC, TYPE_NETCAM, NO_ERRNO,_("Camera did not reconnect."));
-            MOTION_LOG(NTC, TYPE_NETCAM, NO_ERRNO,_("Checking for camera every 30 seconds."));
-            reconnect_count++;
-            slp_dur = 30;
+    struct timespec tmp_tm;
+    int slp_ms;
+
+    if (handler_running == true) {
+        return;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &tmp_tm);
+
+    if (reconnect_tm.tv_sec == 0) {
+        if (lost_tm.tv_sec == 0) {
+            lost_tm = tmp_tm;
         }
         netcam_stop();
+        slp_ms = reconnect_backoff();
+        MOTION_LOG(NTC, TYPE_NETCAM, NO_ERRNO
+            ,_("%s:Camera did not reconnect.  Trying again in %.1f seconds.")
+            ,cameratype.c_str(), (double)slp_ms / 1000.0);
+        reconnect_tm.tv_sec = tmp_tm.tv_sec + (slp_ms / 1000);
+        reconnect_tm.tv_nsec = tmp_tm.tv_nsec + ((slp_ms % 1000) * 1000000L);
+        if (reconnect_tm.tv_nsec >= 1000000000L) {
+            reconnect_tm.tv_sec++;
+            reconnect_tm.tv_nsec -= 1000000000L;
+        }
+        return;
+    }
+
+    if ((tmp_tm.tv_sec < reconnect_tm.tv_sec) ||
+        ((tmp_tm.tv_sec == reconnect_tm.tv_sec) &&
+         (tmp_tm.tv_nsec < reconnect_tm.tv_nsec))) {
+        return;
+    }
 
-        cam->watchdog = slp_dur + (cam->cfg->watchdog_tmo * 3);
+    reconnect_tm.tv_sec = 0;
+    reconnect_tm.tv_nsec = 0;
+    reconnect_attempts++;
 
-        while ((cam->handler_stop == false) && (slp_dur > 0)) {
-            SLEEP(1, 0);
-            slp_dur--;
+    netcam_start();
+}
+
+/*
+ * The decoded images are passed from the handler thread to the camera
+ * thread without locks.  For the latest policy there is one published
+ * buffer which the handler thread trades for its receive buffer and the
+ * camera thread trades for its own.  For the drain policy the buffers
+ * are in a single producer / single consumer ring.
+ */
+void cls_netcam::queue_init()
+{
+    int indx;
+
+    if (queue_policy == NETCAM_QUEUE_LATEST) {
+        queue_size = 1;
+    } else {
+        if (queue_size < 2) {
+            queue_size = 2;
+        } else if (queue_size > NETCAM_QUEUE_MAX) {
+            queue_size = NETCAM_QUEUE_MAX;
+        }
+        indx = 1;
+        while (indx < queue_size) {
+            indx <<= 1;
         }
+        queue_size = indx;
+        MOTION_LOG(INF, TYPE_NETCAM, NO_ERRNO
+            ,_("%s:Draining a queue of %d images")
+            ,cameratype.c_str(), queue_size);
+    }
 
-        cam->watchdog = (cam->cfg->watchdog_tmo * 3);
+    queue_buf_cnt = queue_size + 2;
+    queue_buf =(netcam_buff*) mymalloc((uint)queue_buf_cnt * sizeof(netcam_buff));
+    for (indx=0; indx<queue_buf_cnt; indx++) {
+        queue_buf[indx].ptr =(char*) mymalloc(NETCAM_BUFFSIZE);
+        queue_buf[indx].size = NETCAM_BUFFSIZE;
+    }
+    img_recv = &queue_buf[0];
+    img_latest = &queue_buf[1];
+
+    queue =(netcam_buff_ptr*) mymalloc((uint)queue_size * sizeof(netcam_buff_ptr));
+    for (indx=0; indx<queue_size; indx++) {
+        queue[indx] = &queue_buf[indx + 2];
+    }
+
+    queue_head = 0;
+    queue_tail = 0;
+    queue_latest = 2;
+    queue_drops = 0;
+    queue_depth = 0;
+    queue_depth_max = 0;
+}
+
+void cls_netcam::queue_free()
+{
+    int indx;
+
+    if (queue_buf == nullptr) {
+        return;
+    }
+
+    MOTION_LOG(INF, TYPE_NETCAM, NO_ERRNO
+        ,_("%s:Images dropped %u, most images waiting %d")
+        ,cameratype.c_str(), queue_drops.load(), queue_depth_max);
+
+    for (indx=0; indx<queue_buf_cnt; indx++) {
+        myfree(queue_buf[indx].ptr);
+    }
+    myfree(queue_buf);
+    myfree(queue);
+    img_recv = nullptr;
+    img_latest = nullptr;
+}
+
+/* Publish img_recv to the camera thread.  Handler thread only */
+void cls_netcam::queue_push()
+{
+    netcam_buff_ptr xchg;
+    uint head, tail;
+    int indx;
+
+    if (queue_policy == NETCAM_QUEUE_LATEST) {
+        indx = queue_latest.exchange(
+            (int)(img_recv - queue_buf) | NETCAM_QUEUE_FRESH
+            , std::memory_order_acq_rel);
+        if ((indx & NETCAM_QUEUE_FRESH) != 0) {
+            queue_drops++;
+        }
+        img_recv = &queue_buf[indx & ~NETCAM_QUEUE_FRESH];
+        return;
+    }
+
+    head = queue_head.load(std::memory_order_relaxed);
+    tail = queue_tail.load(std::memory_order_acquire);
+    if ((head - tail) >= (uint)queue_size) {
+        /* Full so img_recv is reused for the next image */
+        queue_drops++;
+        return;
+    }
+    xchg = queue[head & (uint)(queue_size - 1)];
+    queue[head & (uint)(queue_size - 1)] = img_recv;
+    img_recv = xchg;
+    queue_head.store(head + 1, std::memory_order_release);
+}
+
+/* Take the next image into img_latest.  Camera thread only */
+bool cls_netcam::queue_pop()
+{
+    netcam_buff_ptr xchg;
+    uint head, tail;
+    int indx;
 
-        netcam_start();
+    if (queue_policy == NETCAM_QUEUE_LATEST) {
+        if ((queue_latest.load(std::memory_order_relaxed) & NETCAM_QUEUE_FRESH) == 0) {
+            queue_depth = 0;
+            return false;
+        }
+        indx = queue_latest.exchange(
+            (int)(img_latest - queue_buf), std::memory_order_acq_rel);
+        img_latest = &queue_buf[indx & ~NETCAM_QUEUE_FRESH];
+        queue_depth = 1;
+        queue_depth_max = MAX(queue_depth_max, queue_depth);
+        return true;
     }
+
+    tail = queue_tail.load(std::memory_order_relaxed);
+    head = queue_head.load(std::memory_order_acquire);
+    queue_depth = (int)(head - tail);
+    queue_depth_max = MAX(queue_depth_max, queue_depth);
+    if (head == tail) {
+        return false;
+    }
+    xchg = queue[tail & (uint)(queue_size - 1)];
+    queue[tail & (uint)(queue_size - 1)] = img_latest;
+    img_latest = xchg;
+    queue_tail.store(tail + 1, std::memory_order_release);
+
+    return true;
+}
+
+/*
+ * Whether the decoded norm image may be handed to the camera ring by
+ * trading buffers.  When the image is not new, the copy is taken from
+ * image_virgin which is only the same image when nothing rotates it.
+ */
+bool cls_netcam::handoff_ok()
+{
+    if ((cam->imgs.image_virgin == nullptr) ||
+        ((cam->cfg->rotate % 360) != 0) ||
+        (cam->cfg->flip_axis == "horizontal") ||
+        (cam->cfg->flip_axis == "vertical")) {
+        return false;
+    }
+    return true;
 }
 
 int cls_netcam::next(ctx_image_data *img_data)
 {
+    u_char *xchg;
+    bool fresh;
+    struct timespec curr_tm;
+
     if ((status == NETCAM_RECONNECTING) ||
         (status == NETCAM_NOTCONNECTED)) {
         return CAPTURE_ATTEMPTED;
@@ -2444,20 +3238,68 @@ int cls_netcam::next(ctx_image_data *img_data)
 
     pthread_mutex_lock(&mutex);
         pktarray_resize();
-        if (high_resolution == false) {
+        if ((high_resolution == true) &&
+            (cam->netcam_high->passthrough == true)) {
+            img_data->idnbr_high = idnbr;
+        }
+    pthread_mutex_unlock(&mutex);
+
+    if ((high_resolution == true) &&
+        (cam->netcam_high->passthrough == true)) {
+        return CAPTURE_SUCCESS;
+    }
+
+    fresh = queue_pop();
+
+    if (fresh == true) {
+        ltncy_time();
+    }
+
+    if ((fresh == true) && (queue_policy == NETCAM_QUEUE_DRAIN)) {
+        /* The image may have waited so use the time it was received */
+        clock_gettime(CLOCK_MONOTONIC, &curr_tm);
+        img_data->imgts.tv_sec -= (curr_tm.tv_sec - img_latest->image_time.tv_sec);
+        img_data->imgts.tv_nsec -= (curr_tm.tv_nsec - img_latest->image_time.tv_nsec);
+        while (img_data->imgts.tv_nsec < 0) {
+            img_data->imgts.tv_sec--;
+            img_data->imgts.tv_nsec += 1000000000L;
+        }
+        while (img_data->imgts.tv_nsec >= 1000000000L) {
+            img_data->imgts.tv_sec++;
+            img_data->imgts.tv_nsec -= 1000000000L;
+        }
+        img_data->monots = img_latest->image_time;
+    }
+
+    if (high_resolution == true) {
+        img_data->idnbr_high = img_latest->idnbr;
+        memcpy(img_data->image_high
+            , img_latest->ptr
+            , img_latest->used);
+    } else {
+        img_data->idnbr_norm = img_latest->idnbr;
+        if (handoff_ok() == false) {
             memcpy(img_data->image_norm
                 , img_latest->ptr
                 , img_latest->used);
-            img_data->idnbr_norm = idnbr;
+        } else if (fresh == false) {
+            /* The latest decoded image was already handed over */
+            memcpy(img_data->image_norm
+                , cam->imgs.image_virgin
+                , (uint)cam->imgs.size_norm);
+        } else if (img_latest->used == (uint)cam->imgs.size_norm) {
+            /* Trade buffers with the ring instead of copying */
+            xchg = img_data->image_norm;
+            img_data->image_norm = (u_char*)img_latest->ptr;
+            img_latest->ptr = (char*)xchg;
+            img_latest->size = (uint)cam->imgs.size_norm;
+            img_latest->used = 0;
         } else {
-            img_data->idnbr_high = idnbr;
-            if (cam->netcam_high->passthrough == false) {
-                memcpy(img_data->image_high
-                    , img_latest->ptr
-                    , img_latest->used);
-            }
+            memcpy(img_data->image_norm
+                , img_latest->ptr
+                , img_latest->used);
         }
-    pthread_mutex_unlock(&mutex);
+    }
 
     return CAPTURE_SUCCESS;
 }
@@ -2467,7 +3309,35 @@ cls_netcam::cls_netcam(cls_camera *p_cam, bool p_is_high)
     cam = p_cam;
     high_resolution = p_is_high;
     reconnect_count = 0;
+    start_held = false;
+    start_msec = 0;
+    probe_cache = false;
+    probe_file = "";
+    probe.have = false;
+    ltncy_usec = 0;
+    ltncy_usec_max = 0;
+    ltncy_base = INT64_MAX;
+    clock_gettime(CLOCK_MONOTONIC, &ltncy_log_tm);
+    reconnect_attempts = 0;
+    reconnect_success = 0;
+    reconnect_msec = 0;
+    reconnect_min = 1;
+    reconnect_max = 60;
+    lost_tm.tv_sec = 0;
+    lost_tm.tv_nsec = 0;
+    clock_gettime(CLOCK_MONOTONIC, &reconnect_tm);
+    reconnect_seed = (uint)reconnect_tm.tv_nsec ^
+        ((uint)cam->cfg->device_id << 16) ^ (p_is_high ? 1U : 0U);
+    reconnect_tm.tv_sec = 0;
+    reconnect_tm.tv_nsec = 0;
     cameratype = "";
+    img_recv = nullptr;
+    img_latest = nullptr;
+    decode_threads = 0;
+    decode_usec = 0;
+    decode_usec_max = 0;
+    queue_buf = nullptr;
+    queue = nullptr;
 
     pthread_mutex_init(&mutex, nullptr);
     pthread_mutex_init(&mutex_pktarray, nullptr);
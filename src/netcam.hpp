@@ -22,6 +22,8 @@
 #define _INCLUDE_NETCAM_HPP_
 
 #define NETCAM_BUFFSIZE 4096
+#define NETCAM_QUEUE_MAX    64      /* Largest number of images waiting in the queue */
+#define NETCAM_QUEUE_FRESH  0x100   /* Flag on the published buffer not yet taken by the camera */
 
 enum NETCAM_STATUS {
     NETCAM_CONNECTED,      /* The camera is currently connected */
@@ -30,6 +32,11 @@ enum NETCAM_STATUS {
     NETCAM_RECONNECTING   /* Motion is trying to reconnect to camera */
 };
 
+enum NETCAM_QUEUE_POLICY {
+    NETCAM_QUEUE_LATEST,   /* Only the most recent image is handed to the camera */
+    NETCAM_QUEUE_DRAIN     /* Every decoded image is handed to the camera in order */
+};
+
 struct ctx_imgsize {
     int                   width;
     int                   height;
@@ -54,14 +61,29 @@ typedef struct netcam_image_buff {
     size_t size;                    /* total allocated size */
     size_t used;                    /* bytes already used */
     struct timespec image_time;      /* time this image was received */
+    int64_t idnbr;                  /* id number of the packet for this image */
+    int64_t ltncy;                  /* usec the image was received later than its PTS implied */
 } netcam_buff;
 typedef netcam_buff *netcam_buff_ptr;
 
 struct ctx_packet_item{
     AVPacket                 *packet;
     int64_t                   idnbr;
+    int64_t                   idnbr_key;    /* idnbr of the video key frame that starts the group */
     bool                      iskey;
-    bool                      iswritten;
+};
+
+/* Stream values kept from the last probe of the camera */
+struct ctx_netcam_probe {
+    bool          have;         /* Whether the values are loaded */
+    std::string   url;          /* The path the values were probed from, without the userpass */
+    int           codec_id;
+    int           width;
+    int           height;
+    int           pix_fmt;
+    int           fps_num;
+    int           fps_den;
+    std::string   extradata;    /* Codec extradata as hex text */
 };
 
 struct ctx_filelist_item {
@@ -91,8 +113,21 @@ class cls_netcam {
         AVFormatContext          *transfer_format;       /* Format context just for transferring to pass-through */
         ctx_packet_item          *pktarray;              /* Pointer to array of packets for passthru processing */
         int                       pktarray_size;         /* The number of packets in array.  1 based */
+        int                       pktarray_index;        /* The index to the most current packet in array */
         int                       video_stream_index;       /* Stream index associated with video from camera */
         int                       audio_stream_index;       /* Stream index associated with audio from camera */
+        std::atomic<uint>         queue_drops;      /* Count of decoded images never handed to the camera */
+        int                       queue_depth;      /* Images that were waiting at the last call to next */
+        int                       queue_depth_max;  /* Most images that were waiting at a call to next */
+        int                       decode_threads;   /* Threads given to the decoder from the shared budget */
+        int64_t                   decode_usec;      /* Smoothed time to decode a packet in microseconds */
+        int64_t                   decode_usec_max;  /* Longest time to decode a packet in microseconds */
+        std::atomic<uint>         reconnect_attempts;   /* Connection attempts made while the camera was lost */
+        std::atomic<uint>         reconnect_success;    /* Count of the times the camera came back */
+        int64_t                   ltncy_usec;       /* Smoothed latency from the PTS to the camera thread in microseconds */
+        int64_t                   ltncy_usec_max;   /* Longest latency from the PTS to the camera thread in microseconds */
+        int64_t                   start_msec;       /* Time from starting the camera to its first image in milliseconds */
+        int64_t                   reconnect_msec;   /* Time from losing the camera to getting it back in milliseconds */
 
         bool            handler_stop;
         bool            handler_running;
@@ -100,6 +135,8 @@ class cls_netcam {
         void            handler();
 
         int next(ctx_image_data *img_data);
+        int pktarray_slot(int64_t id);
+        int pktarray_firstkey();
         void noimage();
         void netcam_start();
         void netcam_stop();
@@ -109,12 +146,11 @@ class cls_netcam {
         AVCodecContext           *codec_context;         /* Codec being sent from the camera */
         AVStream                 *strm;
         AVFrame                  *frame;                 /* Reusable frame for images from camera */
-        AVFrame                  *swsframe_in;           /* Used when resizing image sent from camera */
         AVFrame                  *swsframe_out;          /* Used when resizing image sent from camera */
         struct SwsContext        *swsctx;                /* Context for the resizing of the image */
         AVPacket                 *packet_recv;           /* The packet that is currently being processed */
 
-        int                       pktarray_index;        /* The index to the most current packet in array */
+        int64_t                   pktarray_key;          /* idnbr of the last video key frame added */
         int64_t                   idnbr;                 /* A ID number to track the packet vs image */
         AVDictionary             *opts;                  /* AVOptions when opening the format context */
         int                       swsframe_size;         /* The size of the image after resizing */
@@ -125,7 +161,24 @@ class cls_netcam {
         myAVCodec                *decoder;
 
         netcam_buff_ptr           img_recv;         /* The image buffer that is currently being processed */
-        netcam_buff_ptr           img_latest;       /* The most recent image buffer that finished processing */
+        netcam_buff_ptr           img_latest;       /* The image buffer last taken from the queue by the camera */
+        netcam_buff              *queue_buf;        /* All image buffers.  The queue slots plus img_recv and img_latest */
+        int                       queue_buf_cnt;    /* Number of image buffers */
+        netcam_buff_ptr          *queue;            /* Drain: Image buffers held by the queue slots */
+        int                       queue_size;       /* Drain: Number of queue slots.  A power of two */
+        enum NETCAM_QUEUE_POLICY  queue_policy;     /* Whether the latest or every image is handed to the camera */
+        std::atomic<uint>         queue_head;       /* Drain: Count of slots filled by the handler thread */
+        std::atomic<uint>         queue_tail;       /* Drain: Count of slots emptied by the camera thread */
+        std::atomic<int>          queue_latest;     /* Latest: Index of the published buffer and fresh flag */
+        enum AVDiscard            decode_idle;      /* Frames the decoder skips while not detecting motion */
+        bool                      start_held;       /* Whether this camera holds one of the netcam_start_max slots */
+        bool                      probe_cache;      /* Whether the stream probe is cached */
+        std::string               probe_file;       /* File that keeps the stream probe over restarts */
+        std::string               probe_url;        /* The path without the userpass */
+        ctx_netcam_probe          probe;            /* Values from the last stream probe */
+        bool                      ltncy_low;        /* Whether the low latency profile is used */
+        int64_t                   ltncy_base;       /* Smallest gap seen between the arrival and the PTS of an image */
+        struct timespec           ltncy_log_tm;     /* Camera thread: When the latency was last logged */
 
         bool                      high_resolution;  /* Boolean for whether this context is the Norm or High */
 
@@ -138,6 +191,11 @@ class cls_netcam {
 
         int                       capture_rate;     /* Frames per second from configuration file */
         int                       reconnect_count;  /* Count of the times reconnection is tried*/
+        int                       reconnect_min;    /* Seconds to wait after the first failed reconnect */
+        int                       reconnect_max;    /* Most seconds to wait between reconnects */
+        uint                      reconnect_seed;   /* Seed for the jitter on the wait */
+        struct timespec           reconnect_tm;     /* Camera thread: When the next restart is due */
+        struct timespec           lost_tm;          /* Time when the camera was lost */
         int                       src_fps;          /* The fps provided from source*/
         std::string               decoder_nm;       /* User requested decoder */
 
@@ -158,6 +216,8 @@ class cls_netcam {
         int         cfg_height;
         int         cfg_framerate;
         int         cfg_idur;
+        int         cfg_thread_count;
+        std::string cfg_thread_type;
         std::string cfg_params;
 
         std::vector<ctx_filelist_item>    filelist;
@@ -180,7 +240,11 @@ class cls_netcam {
         int decode_vaapi();
         int decode_cuda();
         int decode_drm();
+        void decode_throttle();
         int decode_video();
+        void decode_time(struct timespec *beg_tm, struct timespec *end_tm);
+        void ltncy_mark();
+        void ltncy_time();
         int decode_packet();
         void hwdecoders();
         void decoder_error(int retcd, const char* fnc_nm);
@@ -188,6 +252,8 @@ class cls_netcam {
         int init_cuda();
         int init_drm();
         int init_swdecoder();
+        void decode_threads_set();
+        void decode_threads_release();
         int open_codec();
         int open_sws();
         int resize();
@@ -201,10 +267,25 @@ class cls_netcam {
         int open_context();
         int connect();
 
+        bool start_wait();
+        void start_release();
+        void start_open();
+        void probe_load();
+        void probe_save();
+        void probe_opts();
+        void probe_apply();
+
         void handler_wait();
         void handler_reconnect();
+        int reconnect_backoff();
+        void reconnect_done();
         void handler_startup();
         void handler_shutdown();
+        bool handoff_ok();
+        void queue_init();
+        void queue_free();
+        void queue_push();
+        bool queue_pop();
 
 };
 
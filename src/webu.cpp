@@ -30,6 +30,7 @@
 #include "webu_file.hpp"
 #include "webu_stream.hpp"
 #include "webu_mpegts.hpp"
+#include "webu_getimg.hpp"
 #include "video_v4l2.hpp"
 
 /* Initialize the MHD answer */
@@ -171,6 +172,23 @@ void cls_webu::mhd_features_tls()
     #endif
 }
 
+/* Validate that the MHD version installed can suspend connections in a thread pool */
+void cls_webu::mhd_features_pool()
+{
+    #if MHD_VERSION < 0x00095900
+        if (cfg->webcontrol_threads > 0) {
+            MOTION_LOG(INF, TYPE_STREAM, NO_ERRNO ,_("libmicrohttpd libary too old thread pool disabled"));
+        }
+        wb_pool = false;
+    #else
+        wb_pool = (cfg->webcontrol_threads > 0);
+        if (wb_pool) {
+            MOTION_LOG(DBG, TYPE_STREAM, NO_ERRNO
+                ,_("Thread pool: %d threads"), cfg->webcontrol_threads);
+        }
+    #endif
+}
+
 /* Validate the features that MHD can support */
 void cls_webu::mhd_features()
 {
@@ -178,6 +196,7 @@ void cls_webu::mhd_features()
     mhd_features_digest();
     mhd_features_ipv6();
     mhd_features_tls();
+    mhd_features_pool();
 }
 
 /* Load a either the key or cert file for MHD*/
@@ -334,6 +353,17 @@ void cls_webu::mhd_opts_tls()
 
 }
 
+/* Set the MHD option for the size of the thread pool serving connections */
+void cls_webu::mhd_opts_pool()
+{
+    if (wb_pool) {
+        mhdst->mhd_ops[mhdst->mhd_opt_nbr].option = MHD_OPTION_THREAD_POOL_SIZE;
+        mhdst->mhd_ops[mhdst->mhd_opt_nbr].value = (unsigned int)cfg->webcontrol_threads;
+        mhdst->mhd_ops[mhdst->mhd_opt_nbr].ptr_value = NULL;
+        mhdst->mhd_opt_nbr++;
+    }
+}
+
 /* Set all the MHD options based upon the configuration parameters*/
 void cls_webu::mhd_opts()
 {
@@ -345,6 +375,7 @@ void cls_webu::mhd_opts()
     mhd_opts_localhost();
     mhd_opts_digest();
     mhd_opts_tls();
+    mhd_opts_pool();
 
     mhdst->mhd_ops[mhdst->mhd_opt_nbr].option = MHD_OPTION_END;
     mhdst->mhd_ops[mhdst->mhd_opt_nbr].value = 0;
@@ -356,7 +387,14 @@ void cls_webu::mhd_opts()
 /* Set the mhd start up flags */
 void cls_webu::mhd_flags()
 {
-    mhdst->mhd_flags = MHD_USE_THREAD_PER_CONNECTION;
+    if (wb_pool) {
+        #if MHD_VERSION >= 0x00095900
+            mhdst->mhd_flags = MHD_USE_INTERNAL_POLLING_THREAD |
+                MHD_USE_AUTO | MHD_ALLOW_SUSPEND_RESUME;
+        #endif
+    } else {
+        mhdst->mhd_flags = MHD_USE_THREAD_PER_CONNECTION;
+    }
 
     if (mhdst->ipv6) {
         mhdst->mhd_flags = mhdst->mhd_flags | MHD_USE_DUAL_STACK;
@@ -494,6 +532,10 @@ void cls_webu::shutdown()
     MOTION_LOG(NTC, TYPE_STREAM, NO_ERRNO
         , _("Closing webcontrol on port %d"), portnbr);
 
+    if (allcam != nullptr) {
+        webu_getimg_wake(&allcam->stream);
+    }
+
     chkcnt = 0;
     while ((chkcnt < 1000) && (cnct_cnt >0)) {
         SLEEP(0, 5000000);
@@ -510,6 +552,13 @@ void cls_webu::shutdown()
         wb_daemon = nullptr;
     }
 
+    pthread_mutex_lock(&mutex_tsenc);
+        while (tsenc_list.empty() == false) {
+            delete tsenc_list.front();
+            tsenc_list.pop_front();
+        }
+    pthread_mutex_unlock(&mutex_tsenc);
+
     mydelete(wb_actions);
     mydelete(wb_headers);
     mydelete(allcam);
@@ -521,12 +570,15 @@ cls_webu::cls_webu(cls_motapp *p_app, cls_config *p_cfg)
     cfg = p_cfg;
     restart = false;
     allcam = nullptr;
+    wb_pool = false;
     shutdown_in_progress = false;
     pthread_mutex_init(&mutex_camlst, NULL);
+    pthread_mutex_init(&mutex_tsenc, NULL);
 }
 
 cls_webu::~cls_webu()
 {
     shutdown();
     pthread_mutex_destroy(&mutex_camlst);
+    pthread_mutex_destroy(&mutex_tsenc);
 }
@@ -23,7 +23,7 @@
     #define WEBUI_LEN_PARM 512          /* Parameters specified */
     #define WEBUI_LEN_URLI 512          /* Maximum URL permitted */
     #define WEBUI_LEN_RESP 1024         /* Initial response size */
-    #define WEBUI_MHD_OPTS 10           /* Maximum number of options permitted for MHD */
+    #define WEBUI_MHD_OPTS 12           /* Maximum number of options permitted for MHD */
 
     #define WEBUI_POST_BFRSZ  512
 
@@ -102,12 +102,15 @@
             ctx_params                  *wb_actions;
             char                        wb_digest_rand[12];
             struct MHD_Daemon           *wb_daemon;
+            bool                        wb_pool;            /* Connections share a thread pool and suspend while waiting */
             std::list<ctx_webu_clients> wb_clients;
             std::string                 info_tls;
             int                         cnct_cnt;
             bool                        restart;
             bool                        conf_chg;
             pthread_mutex_t             mutex_camlst;       /* Lock the list of cams while adding/removing */
+            std::list<cls_webu_tsenc*>  tsenc_list;         /* Transport stream encoders shared by the connections */
+            pthread_mutex_t             mutex_tsenc;        /* Lock the list of transport stream encoders */
             int                         webuindx;
             int                         portnbr;
             void startup();
@@ -121,6 +124,7 @@
             void mhd_features_digest();
             void mhd_features_ipv6();
             void mhd_features_tls();
+            void mhd_features_pool();
             void mhd_features();
             void mhd_loadfile(std::string fname, std::string &filestr);
             void mhd_checktls();
@@ -129,6 +133,7 @@
             void mhd_opts_localhost();
             void mhd_opts_digest();
             void mhd_opts_tls();
+            void mhd_opts_pool();
             void mhd_opts();
             void mhd_flags();
     };
@@ -25,6 +25,7 @@
 #include "webu_allcam.hpp"
 #include "camera.hpp"
 #include "jpegutils.hpp"
+#include "webu_getimg.hpp"
 
 
 static void *allcam_handler(void *arg)
@@ -63,7 +64,7 @@ void cls_allcam::getsizes_img(int indx)
 void cls_allcam::getimg_src(cls_camera *p_cam
     , std::string imgtyp, u_char *dst_img, u_char *src_img, int indx_act)
 {
-    int indx;
+    struct timespec ts;
     ctx_stream_data *strm_c;
 
     if (imgtyp == "norm") {
@@ -78,20 +79,18 @@ void cls_allcam::getimg_src(cls_camera *p_cam
         return;
     }
 
+    /* Wait up to a second for the camera to publish its first image */
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_sec++;
     pthread_mutex_lock(&p_cam->stream.mutex);
-        indx=0;
-        while (indx < 1000) {
-            if (strm_c->img_data == nullptr) {
-                if (strm_c->all_cnct == 0){
-                    strm_c->all_cnct++;
-                }
-                pthread_mutex_unlock(&p_cam->stream.mutex);
-                    SLEEP(0, 1000);
-                pthread_mutex_lock(&p_cam->stream.mutex);
-            } else {
+        while (strm_c->img_data == nullptr) {
+            if (strm_c->all_cnct == 0){
+                strm_c->all_cnct++;
+            }
+            if (pthread_cond_timedwait(&p_cam->stream.cond
+                , &p_cam->stream.mutex, &ts) != 0) {
                 break;
             }
-            indx++;
         }
         if ((p_cam->imgs.height != active_cam[indx_act].src_h) ||
             (p_cam->imgs.width  != active_cam[indx_act].src_w)) {
@@ -132,6 +131,7 @@ void cls_allcam::getimg(ctx_stream_data *strm_a, std::string imgtyp)
     int indx, row, dst_w, dst_h;
     u_char *dst_img, *src_img, *all_img;
     cls_camera *p_cam;
+    ctx_stream_jpg *jpg;
 
     getsizes();
 
@@ -190,10 +190,14 @@ void cls_allcam::getimg(ctx_stream_data *strm_a, std::string imgtyp)
             , strm_a->img_data, info.dst_w, info.dst_h);
         myfree(all_img);
 
-        strm_a->jpg_sz = jpgutl_put_yuv420p(
-            strm_a->jpg_data, info.dst_sz, strm_a->img_data
+        stream.frame_seq++;
+        jpg = webu_getimg_jpg_new(strm_a, info.dst_sz);
+        jpg->sz = jpgutl_put_yuv420p(
+            jpg->data, jpg->alloc_sz, strm_a->img_data
             , info.dst_w, info.dst_h
             , 70, NULL,NULL,NULL);
+        jpg->quality = 70;
+        jpg->frame_seq = stream.frame_seq;
 
         strm_a->consumed = false;
     pthread_mutex_unlock(&stream.mutex);
@@ -218,7 +222,7 @@ void cls_allcam::stream_free()
             strm = &stream.sub;
         }
         myfree(strm->img_data);
-        myfree(strm->jpg_data);
+        webu_getimg_jpg_put(strm->jpg);
     }
 
 }
@@ -242,8 +246,6 @@ void cls_allcam::stream_alloc()
         }
         strm->img_data = (unsigned char*)
             mymalloc((size_t)info.dst_sz);
-        strm->jpg_data = (unsigned char*)
-            mymalloc((size_t)info.dst_sz);
         strm->consumed = true;
     }
 
@@ -776,6 +778,7 @@ void cls_allcam::handler()
             (stream.secondary.consumed == true)) {
             getimg(&stream.secondary,"secondary");
         }
+        webu_getimg_wake(&stream);
         timing();
     }
 
@@ -849,6 +852,8 @@ void cls_allcam::handler_shutdown()
 
 cls_allcam::cls_allcam(cls_webu *p_webu, int p_indx)
 {
+    pthread_condattr_t cond_attr;
+
     webu = p_webu;
     app = p_webu->app;
 
@@ -857,7 +862,25 @@ cls_allcam::cls_allcam(cls_webu *p_webu, int p_indx)
     handler_stop = true;
     finish = false;
     memset(&info, 0, sizeof(ctx_allcam_info));
-    memset(&stream, 0, sizeof(ctx_stream));
+    memset(&stream.norm, 0, sizeof(ctx_stream_data));
+    memset(&stream.sub, 0, sizeof(ctx_stream_data));
+    memset(&stream.motion, 0, sizeof(ctx_stream_data));
+    memset(&stream.source, 0, sizeof(ctx_stream_data));
+    memset(&stream.secondary, 0, sizeof(ctx_stream_data));
+    stream.wait_list.clear();
+    stream.frame_seq = 0;
+    memset(&stream.frame_ts, 0, sizeof(struct timespec));
+    stream.enc_frame = NULL;
+    stream.enc_busy = 0;
+    stream.enc_cnt = 0;
+    stream.enc_drop = 0;
+    stream.enc_usec = 0;
+    stream.enc_usec_max = 0;
+    stream.tile_dirty_cnt = 0;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&stream.cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
     reset = true;
     pthread_mutex_init(&stream.mutex, NULL);
     stream.motion.consumed = true;
@@ -878,5 +901,6 @@ cls_allcam::~cls_allcam()
     finish = true;
     handler_shutdown();
     pthread_mutex_destroy(&stream.mutex);
+    pthread_cond_destroy(&stream.cond);
     stream_free();
 }
@@ -31,6 +31,7 @@
 #include "webu_text.hpp"
 #include "webu_post.hpp"
 #include "webu_file.hpp"
+#include "webu_getimg.hpp"
 #include "video_v4l2.hpp"
 
 static mhdrslt webua_connection_values (void *cls
@@ -1025,7 +1026,7 @@ void cls_webu_ans::deinit_counter()
                 (strm->ts_cnct == 0) &&
                 (p_cam->passflag)) {
                     myfree(strm->img_data);
-                    myfree(strm->jpg_data);
+                    webu_getimg_jpg_put(strm->jpg);
             }
         pthread_mutex_unlock(&p_cam->stream.mutex);
     }
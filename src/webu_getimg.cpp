@@ -22,6 +22,7 @@
 #include "logger.hpp"
 #include "camera.hpp"
 #include "picture.hpp"
+#include "jpegutils.hpp"
 #include "alg_sec.hpp"
 #include "webu_getimg.hpp"
 
@@ -32,40 +33,47 @@ void webu_getimg_init(cls_camera *cam)
 {
     cam->imgs.image_substream = NULL;
 
-    cam->stream.norm.jpg_sz = 0;
-    cam->stream.norm.jpg_data = NULL;
+    cam->stream.enc_frame = NULL;
+    cam->stream.enc_busy = 0;
+    cam->stream.enc_cnt = 0;
+    cam->stream.enc_drop = 0;
+    cam->stream.enc_usec = 0;
+    cam->stream.enc_usec_max = 0;
+
+    cam->stream.norm.jpg = NULL;
+    cam->stream.norm.enc_seq = 0;
     cam->stream.norm.jpg_cnct = 0;
     cam->stream.norm.ts_cnct = 0;
     cam->stream.norm.all_cnct = 0;
     cam->stream.norm.consumed = true;
     cam->stream.norm.img_data = NULL;
 
-    cam->stream.sub.jpg_sz = 0;
-    cam->stream.sub.jpg_data = NULL;
+    cam->stream.sub.jpg = NULL;
+    cam->stream.sub.enc_seq = 0;
     cam->stream.sub.jpg_cnct = 0;
     cam->stream.sub.ts_cnct = 0;
     cam->stream.sub.all_cnct = 0;
     cam->stream.sub.consumed = true;
     cam->stream.sub.img_data = NULL;
 
-    cam->stream.motion.jpg_sz = 0;
-    cam->stream.motion.jpg_data = NULL;
+    cam->stream.motion.jpg = NULL;
+    cam->stream.motion.enc_seq = 0;
     cam->stream.motion.jpg_cnct = 0;
     cam->stream.motion.ts_cnct = 0;
     cam->stream.motion.all_cnct = 0;
     cam->stream.motion.consumed = true;
     cam->stream.motion.img_data = NULL;
 
-    cam->stream.source.jpg_sz = 0;
-    cam->stream.source.jpg_data = NULL;
+    cam->stream.source.jpg = NULL;
+    cam->stream.source.enc_seq = 0;
     cam->stream.source.jpg_cnct = 0;
     cam->stream.source.ts_cnct = 0;
     cam->stream.source.all_cnct = 0;
     cam->stream.source.consumed = true;
     cam->stream.source.img_data = NULL;
 
-    cam->stream.secondary.jpg_sz = 0;
-    cam->stream.secondary.jpg_data = NULL;
+    cam->stream.secondary.jpg = NULL;
+    cam->stream.secondary.enc_seq = 0;
     cam->stream.secondary.jpg_cnct = 0;
     cam->stream.secondary.ts_cnct = 0;
     cam->stream.secondary.all_cnct = 0;
@@ -78,14 +86,25 @@ void webu_getimg_init(cls_camera *cam)
 void webu_getimg_deinit(cls_camera *cam)
 {
     /* NOTE:  This runs on the camera thread. */
+    if (cam->app->jpgenc != nullptr) {
+        cam->app->jpgenc->cancel(cam);
+        if ((cam->stream.enc_cnt > 0) || (cam->stream.enc_drop > 0)) {
+            MOTION_LOG(INF, TYPE_STREAM, NO_ERRNO
+                , _("Stream encoder: %ld images %ld dropped latency %.1f ms (max %.1f ms)")
+                , (long)cam->stream.enc_cnt, (long)cam->stream.enc_drop
+                , (double)cam->stream.enc_usec / 1000.0
+                , (double)cam->stream.enc_usec_max / 1000.0);
+        }
+    }
+
     myfree(cam->imgs.image_substream);
 
     pthread_mutex_lock(&cam->stream.mutex);
-        myfree(cam->stream.norm.jpg_data);
-        myfree(cam->stream.sub.jpg_data);
-        myfree(cam->stream.motion.jpg_data);
-        myfree(cam->stream.source.jpg_data);
-        myfree(cam->stream.secondary.jpg_data);
+        webu_getimg_jpg_put(cam->stream.norm.jpg);
+        webu_getimg_jpg_put(cam->stream.sub.jpg);
+        webu_getimg_jpg_put(cam->stream.motion.jpg);
+        webu_getimg_jpg_put(cam->stream.source.jpg);
+        webu_getimg_jpg_put(cam->stream.secondary.jpg);
 
         myfree(cam->stream.norm.img_data) ;
         myfree(cam->stream.sub.img_data) ;
@@ -94,6 +113,152 @@ void webu_getimg_deinit(cls_camera *cam)
         myfree(cam->stream.secondary.img_data) ;
     pthread_mutex_unlock(&cam->stream.mutex);
 
+    webu_getimg_wake(&cam->stream);
+
+}
+
+/* Get a jpg for the stream that the camera thread can encode into.
+ * The current jpg is reused when no connection holds a reference to it,
+ * otherwise a new one is allocated and the stream drops the old one.
+ * NOTE: The stream mutex must be held.
+ */
+ctx_stream_jpg *webu_getimg_jpg_new(ctx_stream_data *strm, int bufsz)
+{
+    ctx_stream_jpg *jpg;
+
+    jpg = strm->jpg;
+    if ((jpg != NULL) && (jpg->refcnt == 1) && (jpg->alloc_sz >= bufsz)) {
+        return jpg;
+    }
+
+    webu_getimg_jpg_put(strm->jpg);
+
+    jpg = new ctx_stream_jpg;
+    jpg->data = (u_char*)mymalloc((uint)bufsz);
+    jpg->sz = 0;
+    jpg->alloc_sz = bufsz;
+    jpg->quality = 0;
+    jpg->frame_seq = 0;
+    jpg->refcnt = 1;
+    strm->jpg = jpg;
+
+    return jpg;
+}
+
+/* Take a reference to the current jpg of the stream.
+ * NOTE: The stream mutex must be held.
+ */
+ctx_stream_jpg *webu_getimg_jpg_get(ctx_stream_data *strm)
+{
+    if ((strm->jpg == NULL) || (strm->jpg->sz <= 0)) {
+        return NULL;
+    }
+    strm->jpg->refcnt++;
+    return strm->jpg;
+}
+
+/* Release a reference to a jpg and free it after the last one */
+void webu_getimg_jpg_put(ctx_stream_jpg *&jpg)
+{
+    if (jpg == NULL) {
+        return;
+    }
+    if (jpg->refcnt.fetch_sub(1) == 1) {
+        myfree(jpg->data);
+        delete jpg;
+    }
+    jpg = NULL;
+}
+
+/* Release a reference to an image copy and free it after the last one */
+void webu_getimg_frame_put(ctx_stream_frame *&frame)
+{
+    if (frame == NULL) {
+        return;
+    }
+    if (frame->refcnt.fetch_sub(1) == 1) {
+        myfree(frame->img);
+        delete frame;
+    }
+    frame = NULL;
+}
+
+/* Get a copy of the image for the encoder pool.  The copy is shared
+ * when another stream already copied this image.
+ * NOTE: The stream mutex must be held.
+ */
+static ctx_stream_frame *webu_getimg_frame(cls_camera *cam
+    , u_char *img, int width, int height)
+{
+    ctx_stream_frame *frame;
+    uint img_sz;
+
+    frame = cam->stream.enc_frame;
+    if ((frame == NULL) || (frame->src != img) ||
+        (frame->frame_seq != cam->stream.frame_seq)) {
+        webu_getimg_frame_put(cam->stream.enc_frame);
+        img_sz = (uint)((width * height * 3) / 2);
+        frame = new ctx_stream_frame;
+        frame->img = (u_char*)mymalloc(img_sz);
+        memcpy(frame->img, img, img_sz);
+        frame->src = img;
+        frame->frame_seq = cam->stream.frame_seq;
+        frame->refcnt = 1;
+        cam->stream.enc_frame = frame;
+    }
+    frame->refcnt++;
+
+    return frame;
+}
+
+/* Compress the image into the stream jpg unless it already holds it.
+ * When there is an encoder pool the image is only copied and queued.
+ */
+static void webu_getimg_encode(cls_camera *cam, ctx_stream_data *strm
+    , u_char *img, int width, int height)
+{
+    ctx_stream_jpg *jpg;
+    ctx_jpgenc_job job;
+
+    if ((strm->jpg != NULL) &&
+        (strm->jpg->frame_seq == cam->stream.frame_seq) &&
+        (strm->jpg->quality == cam->cfg->stream_quality)) {
+        return;
+    }
+
+    if (cam->app->jpgenc != nullptr) {
+        if (strm->enc_seq == cam->stream.frame_seq) {
+            return;
+        }
+        strm->enc_seq = cam->stream.frame_seq;
+        job.cam = cam;
+        job.strm = strm;
+        job.frame = webu_getimg_frame(cam, img, width, height);
+        job.width = width;
+        job.height = height;
+        job.bufsz = cam->imgs.size_norm;
+        job.quality = cam->cfg->stream_quality;
+        job.grey = cam->cfg->stream_grey;
+        /* The exif reads the camera and event so the workers get it finished */
+        job.exif = NULL;
+        job.exif_len = jpgutl_exif(&job.exif, cam
+            , &cam->current_image->imgts, NULL);
+        clock_gettime(CLOCK_MONOTONIC, &job.queue_ts);
+        cam->app->jpgenc->submit(&job);
+        return;
+    }
+
+    jpg = webu_getimg_jpg_new(strm, cam->imgs.size_norm);
+    jpg->sz = cam->picture->put_memory(
+        jpg->data
+        ,jpg->alloc_sz
+        ,img
+        ,cam->cfg->stream_quality
+        ,width
+        ,height);
+    jpg->quality = cam->cfg->stream_quality;
+    jpg->frame_seq = cam->stream.frame_seq;
+    strm->consumed = false;
 }
 
 /* Get a normal image from the motion loop and compress it*/
@@ -106,19 +271,11 @@ static void webu_getimg_norm(cls_camera *cam)
     }
 
     if (cam->stream.norm.jpg_cnct > 0) {
-        if (cam->stream.norm.jpg_data == NULL) {
-            cam->stream.norm.jpg_data =(unsigned char*)
-                mymalloc((uint)cam->imgs.size_norm);
-        }
         if (cam->current_image->image_norm != NULL && cam->stream.norm.consumed) {
-            cam->stream.norm.jpg_sz = cam->picture->put_memory(
-                cam->stream.norm.jpg_data
-                ,cam->imgs.size_norm
+            webu_getimg_encode(cam, &cam->stream.norm
                 ,cam->current_image->image_norm
-                ,cam->cfg->stream_quality
                 ,cam->imgs.width
                 ,cam->imgs.height);
-            cam->stream.norm.consumed = false;
         }
     }
     if ((cam->stream.norm.ts_cnct > 0) || (cam->stream.norm.all_cnct > 0)) {
@@ -143,10 +300,6 @@ static void webu_getimg_sub(cls_camera *cam)
     }
 
     if (cam->stream.sub.jpg_cnct > 0) {
-        if (cam->stream.sub.jpg_data == NULL) {
-            cam->stream.sub.jpg_data =(unsigned char*)
-                mymalloc((uint)cam->imgs.size_norm);
-        }
         if (cam->current_image->image_norm != NULL && cam->stream.sub.consumed) {
             /* Resulting substream image must be multiple of 8 */
             if (((cam->imgs.width  % 16) == 0)  &&
@@ -161,24 +314,17 @@ static void webu_getimg_sub(cls_camera *cam)
                     ,cam->imgs.height
                     ,cam->current_image->image_norm
                     ,cam->imgs.image_substream);
-                cam->stream.sub.jpg_sz = cam->picture->put_memory(
-                    cam->stream.sub.jpg_data
-                    ,subsize
+                webu_getimg_encode(cam, &cam->stream.sub
                     ,cam->imgs.image_substream
-                    ,cam->cfg->stream_quality
                     ,(cam->imgs.width / 2)
                     ,(cam->imgs.height / 2));
             } else {
                 /* Substream was not multiple of 8 so send full image*/
-                cam->stream.sub.jpg_sz = cam->picture->put_memory(
-                    cam->stream.sub.jpg_data
-                    ,cam->imgs.size_norm
+                webu_getimg_encode(cam, &cam->stream.sub
                     ,cam->current_image->image_norm
-                    ,cam->cfg->stream_quality
                     ,cam->imgs.width
                     ,cam->imgs.height);
             }
-            cam->stream.sub.consumed = false;
         }
     }
 
@@ -215,18 +361,11 @@ static void webu_getimg_motion(cls_camera *cam)
     }
 
     if (cam->stream.motion.jpg_cnct > 0) {
-        if (cam->stream.motion.jpg_data == NULL) {
-            cam->stream.motion.jpg_data =(unsigned char*)mymalloc((uint)cam->imgs.size_norm);
-        }
         if (cam->imgs.image_motion.image_norm != NULL  && cam->stream.motion.consumed) {
-            cam->stream.motion.jpg_sz = cam->picture->put_memory(
-                cam->stream.motion.jpg_data
-                ,cam->imgs.size_norm
+            webu_getimg_encode(cam, &cam->stream.motion
                 ,cam->imgs.image_motion.image_norm
-                ,cam->cfg->stream_quality
                 ,cam->imgs.width
                 ,cam->imgs.height);
-            cam->stream.motion.consumed = false;
         }
     }
     if ((cam->stream.motion.ts_cnct > 0) || (cam->stream.motion.all_cnct > 0)) {
@@ -249,18 +388,11 @@ static void webu_getimg_source(cls_camera *cam)
     }
 
     if (cam->stream.source.jpg_cnct > 0) {
-        if (cam->stream.source.jpg_data == NULL) {
-            cam->stream.source.jpg_data =(unsigned char*)mymalloc((uint)cam->imgs.size_norm);
-        }
         if (cam->imgs.image_virgin != NULL && cam->stream.source.consumed) {
-            cam->stream.source.jpg_sz = cam->picture->put_memory(
-                cam->stream.source.jpg_data
-                ,cam->imgs.size_norm
+            webu_getimg_encode(cam, &cam->stream.source
                 ,cam->imgs.image_virgin
-                ,cam->cfg->stream_quality
                 ,cam->imgs.width
                 ,cam->imgs.height);
-            cam->stream.source.consumed = false;
         }
     }
     if ((cam->stream.source.ts_cnct > 0) || (cam->stream.source.all_cnct > 0)) {
@@ -276,6 +408,8 @@ static void webu_getimg_source(cls_camera *cam)
 /* Get a secondary image from the motion loop and compress it*/
 static void webu_getimg_secondary(cls_camera *cam)
 {
+    ctx_stream_jpg *jpg;
+
      if ((cam->stream.secondary.jpg_cnct == 0) &&
          (cam->stream.secondary.ts_cnct == 0) &&
          (cam->stream.secondary.all_cnct == 0)) {
@@ -285,18 +419,18 @@ static void webu_getimg_secondary(cls_camera *cam)
     if (cam->stream.secondary.jpg_cnct > 0) {
         if (cam->imgs.size_secondary>0) {
             pthread_mutex_lock(&cam->algsec->mutex);
-                if (cam->stream.secondary.jpg_data == NULL) {
-                    cam->stream.secondary.jpg_data =(unsigned char*)
-                        mymalloc((uint)cam->imgs.size_norm);
-                }
-
-                memcpy(cam->stream.secondary.jpg_data
+                /* The secondary image is already a jpg so it is only copied */
+                jpg = webu_getimg_jpg_new(&cam->stream.secondary
+                    , cam->imgs.size_norm);
+                memcpy(jpg->data
                     , cam->imgs.image_secondary
                     , (uint)cam->imgs.size_secondary);
-                cam->stream.secondary.jpg_sz = cam->imgs.size_secondary;
+                jpg->sz = cam->imgs.size_secondary;
+                jpg->quality = 0;
+                jpg->frame_seq = cam->stream.frame_seq;
             pthread_mutex_unlock(&cam->algsec->mutex);
         } else {
-            myfree(cam->stream.secondary.jpg_data);
+            webu_getimg_jpg_put(cam->stream.secondary.jpg);
         }
     }
     if ((cam->stream.secondary.ts_cnct > 0) || (cam->stream.secondary.all_cnct > 0)) {
@@ -315,10 +449,245 @@ void webu_getimg_main(cls_camera *cam)
 {
     /*This is on the camera thread */
     pthread_mutex_lock(&cam->stream.mutex);
+        /* The same image can be provided more than once so only a
+         * new image gets a new sequence and is compressed again.
+         */
+        if ((cam->current_image->imgts.tv_sec != cam->stream.frame_ts.tv_sec) ||
+            (cam->current_image->imgts.tv_nsec != cam->stream.frame_ts.tv_nsec)) {
+            cam->stream.frame_ts = cam->current_image->imgts;
+            cam->stream.frame_seq++;
+        }
+        cam->stream.tile_dirty_cnt = cam->imgs.tile_dirty_cnt;
         webu_getimg_norm(cam);
         webu_getimg_sub(cam);
         webu_getimg_motion(cam);
         webu_getimg_source(cam);
         webu_getimg_secondary(cam);
+        webu_getimg_frame_put(cam->stream.enc_frame);
     pthread_mutex_unlock(&cam->stream.mutex);
+
+    webu_getimg_wake(&cam->stream);
+}
+
+/* Signal the threads and resume the suspended connections waiting for an image */
+void webu_getimg_wake(ctx_stream *stream)
+{
+    uint indx;
+
+    pthread_mutex_lock(&stream->mutex);
+        for (indx=0; indx<stream->wait_list.size(); indx++) {
+            MHD_resume_connection(stream->wait_list[indx]);
+        }
+        stream->wait_list.clear();
+        pthread_cond_broadcast(&stream->cond);
+    pthread_mutex_unlock(&stream->mutex);
+}
+
+static void *webu_jpgenc_handler(void *arg)
+{
+    ((cls_webu_jpgenc *)arg)->handler();
+    return nullptr;
+}
+
+/* Compress the image of the job and publish it to the stream */
+void cls_webu_jpgenc::encode(ctx_jpgenc_job *job)
+{
+    ctx_stream_jpg *jpg;
+    struct timespec ts;
+    int64_t enc_usec;
+
+    jpg = new ctx_stream_jpg;
+    jpg->data = (u_char*)mymalloc((uint)job->bufsz);
+    jpg->alloc_sz = job->bufsz;
+    jpg->quality = job->quality;
+    jpg->frame_seq = job->frame->frame_seq;
+    jpg->refcnt = 1;
+    if (job->grey) {
+        jpg->sz = jpgutl_put_grey_exif(jpg->data, jpg->alloc_sz
+            , job->frame->img, job->width, job->height, job->quality
+            , job->exif, job->exif_len);
+    } else {
+        jpg->sz = jpgutl_put_yuv420p_exif(jpg->data, jpg->alloc_sz
+            , job->frame->img, job->width, job->height, job->quality
+            , job->exif, job->exif_len);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    enc_usec = ((ts.tv_sec - job->queue_ts.tv_sec) * 1000000) +
+        ((ts.tv_nsec - job->queue_ts.tv_nsec) / 1000);
+
+    pthread_mutex_lock(&job->cam->stream.mutex);
+        /* A connection may have closed and freed the stream jpg so only
+         * skip the image when the stream already has a newer one.
+         */
+        if ((job->strm->jpg == NULL) ||
+            (job->strm->jpg->frame_seq < jpg->frame_seq)) {
+            webu_getimg_jpg_put(job->strm->jpg);
+            job->strm->jpg = jpg;
+            job->strm->consumed = false;
+            jpg = NULL;
+        }
+        if (job->cam->stream.enc_cnt == 0) {
+            job->cam->stream.enc_usec = enc_usec;
+        } else {
+            job->cam->stream.enc_usec =
+                ((job->cam->stream.enc_usec * 15) + enc_usec) / 16;
+        }
+        if (enc_usec > job->cam->stream.enc_usec_max) {
+            job->cam->stream.enc_usec_max = enc_usec;
+        }
+        job->cam->stream.enc_cnt++;
+    pthread_mutex_unlock(&job->cam->stream.mutex);
+
+    webu_getimg_jpg_put(jpg);
+    webu_getimg_wake(&job->cam->stream);
+}
+
+/* Release the image and exif held by a job */
+void cls_webu_jpgenc::job_free(ctx_jpgenc_job *job)
+{
+    webu_getimg_frame_put(job->frame);
+    myfree(job->exif);
+    job->exif_len = 0;
+}
+
+/* Worker thread processing loop */
+void cls_webu_jpgenc::handler()
+{
+    ctx_jpgenc_job job;
+
+    mythreadname_set("je", 0, "");
+
+    pthread_mutex_lock(&mutex);
+    while (true) {
+        while ((queue_cnt == 0) && (stop == false)) {
+            pthread_cond_wait(&cond_job, &mutex);
+        }
+        if (stop) {
+            break;
+        }
+        job = queue[queue_head];
+        queue_head = (queue_head + 1) % WEBU_JPGENC_QUEUE;
+        queue_cnt--;
+        job.cam->stream.enc_busy++;
+        pthread_mutex_unlock(&mutex);
+
+        encode(&job);
+        job_free(&job);
+
+        pthread_mutex_lock(&mutex);
+        job.cam->stream.enc_busy--;
+        pthread_cond_broadcast(&cond_done);
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+/* Queue an image to be compressed.  The camera never waits on the pool.
+ * A stream that still has an image waiting gets it replaced by the newer
+ * one and when the queue is full the new image is dropped.
+ */
+void cls_webu_jpgenc::submit(ctx_jpgenc_job *job)
+{
+    int indx, pos;
+
+    pthread_mutex_lock(&mutex);
+        for (indx = 0; indx < queue_cnt; indx++) {
+            pos = (queue_head + indx) % WEBU_JPGENC_QUEUE;
+            if (queue[pos].strm == job->strm) {
+                job_free(&queue[pos]);
+                queue[pos] = *job;
+                job->cam->stream.enc_drop++;
+                pthread_mutex_unlock(&mutex);
+                return;
+            }
+        }
+        if (queue_cnt == WEBU_JPGENC_QUEUE) {
+            job->cam->stream.enc_drop++;
+            pthread_mutex_unlock(&mutex);
+            job_free(job);
+            return;
+        }
+        pos = (queue_head + queue_cnt) % WEBU_JPGENC_QUEUE;
+        queue[pos] = *job;
+        queue_cnt++;
+        pthread_cond_signal(&cond_job);
+    pthread_mutex_unlock(&mutex);
+}
+
+/* Remove the waiting images of the camera and wait for the ones that the
+ * workers are compressing so the camera can be shut down.
+ */
+void cls_webu_jpgenc::cancel(cls_camera *cam)
+{
+    int indx, pos, keep;
+
+    pthread_mutex_lock(&mutex);
+        keep = 0;
+        for (indx = 0; indx < queue_cnt; indx++) {
+            pos = (queue_head + indx) % WEBU_JPGENC_QUEUE;
+            if (queue[pos].cam == cam) {
+                job_free(&queue[pos]);
+            } else {
+                queue[(queue_head + keep) % WEBU_JPGENC_QUEUE] = queue[pos];
+                keep++;
+            }
+        }
+        queue_cnt = keep;
+        while (cam->stream.enc_busy > 0) {
+            pthread_cond_wait(&cond_done, &mutex);
+        }
+    pthread_mutex_unlock(&mutex);
+}
+
+cls_webu_jpgenc::cls_webu_jpgenc(cls_motapp *p_app)
+{
+    int indx, retcd;
+
+    app = p_app;
+    thread_cnt = app->cfg->stream_encode_threads;
+    queue_head = 0;
+    queue_cnt = 0;
+    stop = false;
+
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&cond_job, NULL);
+    pthread_cond_init(&cond_done, NULL);
+
+    thread = (pthread_t*)mymalloc((uint)thread_cnt * sizeof(pthread_t));
+    for (indx = 0; indx < thread_cnt; indx++) {
+        retcd = pthread_create(&thread[indx], NULL, &webu_jpgenc_handler, this);
+        if (retcd != 0) {
+            MOTION_LOG(WRN, TYPE_STREAM, NO_ERRNO
+                ,_("Unable to start stream encoder thread %d"), indx + 1);
+            thread_cnt = indx;
+            break;
+        }
+    }
+
+    MOTION_LOG(INF, TYPE_STREAM, NO_ERRNO
+        ,_("Stream images compressed using %d threads"), thread_cnt);
+}
+
+cls_webu_jpgenc::~cls_webu_jpgenc()
+{
+    int indx;
+
+    pthread_mutex_lock(&mutex);
+        stop = true;
+        pthread_cond_broadcast(&cond_job);
+    pthread_mutex_unlock(&mutex);
+    for (indx = 0; indx < thread_cnt; indx++) {
+        pthread_join(thread[indx], NULL);
+    }
+    myfree(thread);
+
+    while (queue_cnt > 0) {
+        job_free(&queue[queue_head]);
+        queue_head = (queue_head + 1) % WEBU_JPGENC_QUEUE;
+        queue_cnt--;
+    }
+
+    pthread_mutex_destroy(&mutex);
+    pthread_cond_destroy(&cond_job);
+    pthread_cond_destroy(&cond_done);
 }
@@ -19,8 +19,55 @@
 #ifndef _INCLUDE_WEBU_GETIMG_HPP_
 #define _INCLUDE_WEBU_GETIMG_HPP_
 
+    #define WEBU_JPGENC_QUEUE 32    /* Maximum images waiting for the encoder pool */
+
+    struct ctx_jpgenc_job {
+        cls_camera          *cam;
+        ctx_stream_data     *strm;
+        ctx_stream_frame    *frame;
+        int                 width;
+        int                 height;
+        int                 bufsz;
+        int                 quality;
+        bool                grey;
+        u_char              *exif;      /* APP1 chunk built on the camera thread */
+        uint                exif_len;
+        struct timespec     queue_ts;   /* When the camera provided the image */
+    };
+
+    class cls_webu_jpgenc {
+        public:
+            cls_webu_jpgenc(cls_motapp *p_app);
+            ~cls_webu_jpgenc();
+
+            int             thread_cnt;
+
+            void submit(ctx_jpgenc_job *job);
+            void cancel(cls_camera *cam);
+            void handler();
+
+        private:
+            cls_motapp      *app;
+            pthread_t       *thread;
+            pthread_mutex_t mutex;
+            pthread_cond_t  cond_job;
+            pthread_cond_t  cond_done;
+            ctx_jpgenc_job  queue[WEBU_JPGENC_QUEUE];
+            int             queue_head;
+            int             queue_cnt;
+            bool            stop;
+
+            void encode(ctx_jpgenc_job *job);
+            void job_free(ctx_jpgenc_job *job);
+    };
+
     void webu_getimg_init(cls_camera *cam);
     void webu_getimg_deinit(cls_camera *cam);
     void webu_getimg_main(cls_camera *cam);
+    void webu_getimg_wake(ctx_stream *stream);
+    ctx_stream_jpg *webu_getimg_jpg_new(ctx_stream_data *strm, int bufsz);
+    ctx_stream_jpg *webu_getimg_jpg_get(ctx_stream_data *strm);
+    void webu_getimg_jpg_put(ctx_stream_jpg *&jpg);
+    void webu_getimg_frame_put(ctx_stream_frame *&frame);
 
 #endif
@@ -442,6 +442,7 @@ void cls_webu_json::status_vars(int indx_cam)
     struct tm timestamp_tm;
     struct timespec curr_ts;
     cls_camera *cam;
+    int tile_dirty_cnt;
 
     cam = webu->cam_list[indx_cam];
 
@@ -488,6 +489,18 @@ void cls_webu_json::status_vars(int indx_cam)
 
     webua->resp_page += ",\"user_pause\":\"" + cam->user_pause +"\"";
 
+    /* The count is written by the camera thread so use the published copy */
+    pthread_mutex_lock(&cam->stream.mutex);
+        tile_dirty_cnt = cam->stream.tile_dirty_cnt;
+    pthread_mutex_unlock(&cam->stream.mutex);
+
+    webua->resp_page += ",\"tiles\":{";
+    webua->resp_page += "\"size\":" + std::to_string(TILE_SIZE);
+    webua->resp_page += ",\"count\":" +
+        std::to_string(cam->imgs.tile_cols * cam->imgs.tile_rows);
+    webua->resp_page += ",\"dirty\":" + std::to_string(tile_dirty_cnt);
+    webua->resp_page += "}";
+
     webua->resp_page += "}";
 }
 
@@ -32,9 +32,9 @@
 
 static int webu_mpegts_avio_buf(void *opaque, myuint *buf, int buf_size)
 {
-    cls_webu_mpegts *webu_mpegts;
-    webu_mpegts =(cls_webu_mpegts *)opaque;
-    return webu_mpegts->avio_buf(buf, buf_size);
+    cls_webu_tsenc *webu_tsenc;
+    webu_tsenc =(cls_webu_tsenc *)opaque;
+    return webu_tsenc->avio_buf(buf, buf_size);
 }
 
 static ssize_t webu_mpegts_response(void *cls, uint64_t pos, char *buf, size_t max)
@@ -45,14 +45,213 @@ static ssize_t webu_mpegts_response(void *cls, uint64_t pos, char *buf, size_t m
     return webu_mpegts->response(buf, max);
 }
 
-/********Class Functions ****************************************************/
+/********Shared encoder Functions *******************************************/
+
+/*
+ * All the connections to the same camera and stream type read from one
+ * encoder.  Each encoded packet is muxed into its own slot of a ring so
+ * a new connection can start at the latest key frame and a connection
+ * that falls behind skips ahead to one.  The connection threads take
+ * turns running the encoder under the mutex.
+ */
+int cls_webu_tsenc::avio_buf(myuint *buf, int buf_size)
+{
+    if (pkt_wr->size < (size_t)buf_size + pkt_wr->used) {
+        pkt_wr->size = (size_t)buf_size + pkt_wr->used;
+        pkt_wr->buf = (u_char*)myrealloc(pkt_wr->buf
+            , pkt_wr->size, "tsenc avio_buf");
+    }
+
+    memcpy(pkt_wr->buf + pkt_wr->used, buf, (uint)buf_size);
+    pkt_wr->used += (uint)buf_size;
+
+    return buf_size;
+}
+
+void cls_webu_tsenc::close()
+{
+    if (picture != nullptr) {
+        av_frame_free(&picture);
+        picture = nullptr;
+    }
+    if (ctx_codec != nullptr) {
+        avcodec_free_context(&ctx_codec);
+        ctx_codec = nullptr;
+    }
+    if (fmtctx != nullptr) {
+        if (fmtctx->pb != nullptr) {
+            if (fmtctx->pb->buffer != nullptr) {
+                av_free(fmtctx->pb->buffer);
+                fmtctx->pb->buffer = nullptr;
+            }
+            avio_context_free(&fmtctx->pb);
+            fmtctx->pb = nullptr;
+        }
+        avformat_free_context(fmtctx);
+        fmtctx = nullptr;
+    }
+    myfree(img);
+    img_sz = 0;
+    width = 0;
+    height = 0;
+    seq_base = seq_next;
+}
 
-int cls_webu_mpegts::pic_send(unsigned char *img)
+int cls_webu_tsenc::open(int p_width, int p_height)
+{
+    int retcd;
+    char errstr[128];
+    unsigned char   *buf_image;
+    AVStream        *strm;
+    const AVCodec   *codec;
+    AVDictionary    *opts;
+    size_t          aviobuf_sz;
+
+    if ((ctx_codec != nullptr) &&
+        (width == p_width) && (height == p_height)) {
+        return 0;
+    }
+    close();
+
+    opts = NULL;
+    aviobuf_sz = 4096;
+    clock_gettime(CLOCK_REALTIME, &start_time);
+    clock_gettime(CLOCK_MONOTONIC, &open_time);
+    enc_time.tv_sec = 0;
+    enc_time.tv_nsec = 0;
+
+    fmtctx = avformat_alloc_context();
+    fmtctx->oformat = av_guess_format("mpegts", NULL, NULL);
+    fmtctx->video_codec_id = AV_CODEC_ID_H264;
+
+    codec = avcodec_find_encoder(AV_CODEC_ID_H264);
+    strm = avformat_new_stream(fmtctx, codec);
+
+    /* No global header so that each key frame carries its own headers
+     * for the connections that start there.
+     */
+    ctx_codec = avcodec_alloc_context3(codec);
+    ctx_codec->gop_size      = 15;
+    ctx_codec->codec_id      = AV_CODEC_ID_H264;
+    ctx_codec->codec_type    = AVMEDIA_TYPE_VIDEO;
+    ctx_codec->bit_rate      = 400000;
+    ctx_codec->width         = p_width;
+    ctx_codec->height        = p_height;
+    ctx_codec->time_base.num = 1;
+    ctx_codec->time_base.den = 90000;
+    ctx_codec->pix_fmt       = AV_PIX_FMT_YUV420P;
+    ctx_codec->max_b_frames  = 1;
+    ctx_codec->framerate.num  = 1;
+    ctx_codec->framerate.den  = 1;
+    av_opt_set(ctx_codec->priv_data, "profile", "main", 0);
+    av_opt_set(ctx_codec->priv_data, "crf", "22", 0);
+    av_opt_set(ctx_codec->priv_data, "tune", "zerolatency", 0);
+    av_opt_set(ctx_codec->priv_data, "preset", "superfast",0);
+
+    retcd = avcodec_open2(ctx_codec, codec, &opts);
+    if (retcd < 0) {
+        av_strerror(retcd, errstr, sizeof(errstr));
+        MOTION_LOG(ERR, TYPE_STREAM, NO_ERRNO
+            ,_("Failed to open codec context for %dx%d transport stream: %s")
+            , p_width, p_height, errstr);
+        av_dict_free(&opts);
+        close();
+        return -1;
+    }
+
+    retcd = avcodec_parameters_from_context(strm->codecpar, ctx_codec);
+    if (retcd < 0) {
+        av_strerror(retcd, errstr, sizeof(errstr));
+        MOTION_LOG(ERR, TYPE_STREAM, NO_ERRNO
+            ,_("Failed to copy decoder parameters!: %s"), errstr);
+        av_dict_free(&opts);
+        close();
+        return -1;
+    }
+
+    buf_image = (unsigned char*)av_malloc(aviobuf_sz);
+    fmtctx->pb = avio_alloc_context(
+        buf_image, (int)aviobuf_sz, 1, this
+        , NULL, &webu_mpegts_avio_buf, NULL);
+    fmtctx->flags = AVFMT_FLAG_CUSTOM_IO;
+
+    hdr.used = 0;
+    pkt_wr = &hdr;
+    retcd = avformat_write_header(fmtctx, &opts);
+    if (retcd < 0) {
+        av_strerror(retcd, errstr, sizeof(errstr));
+        MOTION_LOG(ERR, TYPE_STREAM, NO_ERRNO
+            ,_("Failed to write header!: %s"), errstr);
+        av_dict_free(&opts);
+        close();
+        return -1;
+    }
+    avio_flush(fmtctx->pb);
+
+    av_dict_free(&opts);
+
+    width = p_width;
+    height = p_height;
+    img_sz = (width * height * 3) / 2;
+    img = (u_char*)mymalloc((uint)img_sz);
+
+    MOTION_LOG(INF, TYPE_STREAM, NO_ERRNO
+        ,_("Opened %dx%d transport stream encoder"), width, height);
+
+    return 0;
+}
+
+/* The rate of the encoder for the camera stream rate from set_fps.  That
+ * rate comes from the camera so it is the same for each connection.  The
+ * first two seconds after opening are at 30 so that players start quickly.
+ * A connection that joins later starts from the last key frame instead.
+ * NOTE: The encoder mutex must be held.
+ */
+int cls_webu_tsenc::rate(int fps)
+{
+    struct timespec curr_ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &curr_ts);
+    if ((curr_ts.tv_sec - open_time.tv_sec) < 2) {
+        return 30;
+    }
+
+    return fps;
+}
+
+/* Whether it is time for the next image at the rate of the encoder */
+bool cls_webu_tsenc::due(int fps)
+{
+    struct timespec curr_ts;
+    int64_t elapsed;
+
+    if (fps < 1) {
+        fps = 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &curr_ts);
+    elapsed = ((curr_ts.tv_sec - enc_time.tv_sec) * 1000000000L) +
+        (curr_ts.tv_nsec - enc_time.tv_nsec);
+
+    /* Allow a little early so connections at the same rate share the image */
+    if (elapsed < ((900000000L / fps))) {
+        return false;
+    }
+    enc_time = curr_ts;
+
+    return true;
+}
+
+int cls_webu_tsenc::encode()
 {
     int retcd;
     char errstr[128];
     struct timespec curr_ts;
     int64_t pts_interval;
+    AVPacket *pkt;
+
+    if (ctx_codec == nullptr) {
+        return -1;
+    }
 
     if (picture == NULL) {
         picture = av_frame_alloc();
@@ -91,229 +290,215 @@ int cls_webu_mpegts::pic_send(unsigned char *img)
         return -1;
     }
 
-    return 0;
-}
-
-int cls_webu_mpegts::pic_get()
-{
-    int retcd;
-    char errstr[128];
-    AVPacket *pkt;
-
     pkt = NULL;
     pkt = mypacket_alloc(pkt);
+    while (true) {
+        retcd = avcodec_receive_packet(ctx_codec, pkt);
+        if (retcd == AVERROR(EAGAIN)) {
+            break;
+        }
+        if (retcd < 0 ) {
+            av_strerror(retcd, errstr, sizeof(errstr));
+            MOTION_LOG(ERR, TYPE_STREAM, NO_ERRNO
+                ,_("Error receiving encoded packet video:%s"), errstr);
+            av_packet_free(&pkt);
+            return -1;
+        }
 
-    retcd = avcodec_receive_packet(ctx_codec, pkt);
-    if (retcd == AVERROR(EAGAIN)) {
-        av_packet_free(&pkt);
-        pkt = NULL;
-        return -1;
-    }
-    if (retcd < 0 ) {
-        av_strerror(retcd, errstr, sizeof(errstr));
-        MOTION_LOG(ERR, TYPE_STREAM, NO_ERRNO
-            ,_("Error receiving encoded packet video:%s"), errstr);
-        //Packet is freed upon failure of encoding
-        return -1;
-    }
-
-    pkt->pts = picture->pts;
-
-    retcd =  av_interleaved_write_frame(fmtctx, pkt);
-    if (retcd < 0 ) {
-        av_strerror(retcd, errstr, sizeof(errstr));
-        MOTION_LOG(ERR, TYPE_STREAM, NO_ERRNO
-            ,_("Error while writing video frame. %s"), errstr);
-        return -1;
+        av_packet_rescale_ts(pkt, ctx_codec->time_base
+            , fmtctx->streams[0]->time_base);
+        pkt->stream_index = 0;
+
+        pkt_wr = &pkts[seq_next % WEBU_TS_RING];
+        pkt_wr->used = 0;
+        pkt_wr->key = ((pkt->flags & AV_PKT_FLAG_KEY) != 0);
+
+        retcd = av_write_frame(fmtctx, pkt);
+        av_packet_unref(pkt);
+        if (retcd < 0 ) {
+            av_strerror(retcd, errstr, sizeof(errstr));
+            MOTION_LOG(ERR, TYPE_STREAM, NO_ERRNO
+                ,_("Error while writing video frame. %s"), errstr);
+            av_packet_free(&pkt);
+            return -1;
+        }
+        avio_flush(fmtctx->pb);
+        seq_next++;
     }
-
     av_packet_free(&pkt);
-    pkt = NULL;
 
     return 0;
 }
 
-void cls_webu_mpegts::resetpos()
+/* The sequence number of the latest key frame in the ring */
+int64_t cls_webu_tsenc::keyseq()
 {
-    stream_pos = 0;
-    webus->resp_used = 0;
+    int64_t seq, seq_min;
+
+    seq_min = seq_next - WEBU_TS_RING;
+    if (seq_min < seq_base) {
+        seq_min = seq_base;
+    }
+    for (seq = seq_next - 1; seq >= seq_min; seq--) {
+        if (pkts[seq % WEBU_TS_RING].key) {
+            return seq;
+        }
+    }
+    return -1;
 }
 
-int cls_webu_mpegts::getimg()
+/*
+ * Copy the next bytes for a connection.  Whole transport stream packets
+ * are copied so that skipping to a key frame keeps the stream in sync.
+ * Returns 0 when the connection has everything encoded so far.
+ */
+ssize_t cls_webu_tsenc::read(int64_t &seq, size_t &pos, bool &hdr_done
+    , char *buf, size_t max)
 {
-    ctx_stream_data *strm;
-    struct timespec curr_ts;
-    unsigned char *img_data;
-    int img_sz;
+    ctx_webu_ts_pkt *pkt_rd;
+    int64_t seq_min;
+    size_t sent_bytes;
 
-    if (webus->check_finish() == true) {
-        resetpos();
-        return 0;
+    if (max >= WEBU_TS_PKTSZ) {
+        max = max - (max % WEBU_TS_PKTSZ);
     }
 
-    clock_gettime(CLOCK_REALTIME, &curr_ts);
-
-    memset(webus->resp_image, '\0', webus->resp_size);
-    webus->resp_used = 0;
+    pthread_mutex_lock(&mutex);
+        if (hdr_done == false) {
+            if (pos < hdr.used) {
+                sent_bytes = hdr.used - pos;
+                if (sent_bytes > max) {
+                    sent_bytes = max;
+                }
+                memcpy(buf, hdr.buf + pos, sent_bytes);
+                pos += sent_bytes;
+                pthread_mutex_unlock(&mutex);
+                return (ssize_t)sent_bytes;
+            }
+            hdr_done = true;
+            seq = -1;
+            pos = 0;
+        }
 
-    if (webua->device_id > 0) {
-        /* Assign to a local pointer the stream we want */
-        if (webua->cnct_type == WEBUI_CNCT_TS_FULL) {
-            strm = &webua->cam->stream.norm;
-        } else if (webua->cnct_type == WEBUI_CNCT_TS_SUB) {
-            strm = &webua->cam->stream.sub;
-        } else if (webua->cnct_type == WEBUI_CNCT_TS_MOTION) {
-            strm = &webua->cam->stream.motion;
-        } else if (webua->cnct_type == WEBUI_CNCT_TS_SOURCE) {
-            strm = &webua->cam->stream.source;
-        } else if (webua->cnct_type == WEBUI_CNCT_TS_SECONDARY) {
-            strm = &webua->cam->stream.secondary;
-        } else {
-            return 0;
+        seq_min = seq_next - WEBU_TS_RING;
+        if (seq_min < seq_base) {
+            seq_min = seq_base;
         }
-        img_sz = (ctx_codec->width * ctx_codec->height * 3)/2;
-        img_data = (unsigned char*) mymalloc((uint)img_sz);
-        pthread_mutex_lock(&webua->cam->stream.mutex);
-            if (strm->img_data == NULL) {
-                memset(img_data, 0x00, (uint)img_sz);
-            } else {
-                memcpy(img_data, strm->img_data, (uint)img_sz);
-                strm->consumed = true;
+        if ((seq < seq_min) || (seq > seq_next)) {
+            seq = keyseq();
+            pos = 0;
+            if (seq < 0) {
+                pthread_mutex_unlock(&mutex);
+                return 0;
             }
-        pthread_mutex_unlock(&webua->cam->stream.mutex);
-    } else {
-        if (webua->cnct_type == WEBUI_CNCT_TS_FULL) {
-            strm = &webua->webu->allcam->stream.norm;
-        } else if (webua->cnct_type == WEBUI_CNCT_TS_SUB) {
-            strm = &webua->webu->allcam->stream.sub;
-        } else if (webua->cnct_type == WEBUI_CNCT_TS_MOTION) {
-            strm = &webua->webu->allcam->stream.motion;
-        } else if (webua->cnct_type == WEBUI_CNCT_TS_SOURCE) {
-            strm = &webua->webu->allcam->stream.source;
-        } else if (webua->cnct_type == WEBUI_CNCT_TS_SECONDARY) {
-            strm = &webua->webu->allcam->stream.secondary;
-        } else {
+        }
+        if (seq == seq_next) {
+            pthread_mutex_unlock(&mutex);
             return 0;
         }
-        img_sz = webu->allcam->info.dst_sz;
-        img_data = (unsigned char*) mymalloc((uint)img_sz);
-        pthread_mutex_lock(&webua->webu->allcam->stream.mutex);
-            if (strm->img_data == nullptr) {
-                memset(img_data, 0x00, (uint)img_sz);
-            } else {
-                memcpy(img_data, strm->img_data, (uint)img_sz);
-                strm->consumed = true;
-            }
-        pthread_mutex_unlock(&webua->webu->allcam->stream.mutex);
-
-    }
 
-    if (pic_send(img_data) < 0) {
-        myfree(img_data);
-        return -1;
-    }
-    myfree(img_data);
-
-    if (pic_get() < 0) {
-        return -1;
-    }
+        pkt_rd = &pkts[seq % WEBU_TS_RING];
+        sent_bytes = pkt_rd->used - pos;
+        if (sent_bytes > max) {
+            sent_bytes = max;
+        }
+        memcpy(buf, pkt_rd->buf + pos, sent_bytes);
+        pos += sent_bytes;
+        if (pos >= pkt_rd->used) {
+            seq++;
+            pos = 0;
+        }
+    pthread_mutex_unlock(&mutex);
 
-    return 0;
+    return (ssize_t)sent_bytes;
 }
 
-int cls_webu_mpegts::avio_buf(myuint *buf, int buf_size)
+cls_webu_tsenc::cls_webu_tsenc(int p_device_id, enum WEBUI_CNCT p_cnct_type)
 {
-    if (webus->resp_size < (size_t)buf_size + webus->resp_used) {
-        webus->resp_size = (size_t)buf_size + webus->resp_used;
-        webus->resp_image = (unsigned char*)realloc(
-            webus->resp_image, webus->resp_size);
-        MOTION_LOG(ERR, TYPE_STREAM, NO_ERRNO
-            ,_("resp_image reallocated %d %d %d")
-            ,webus->resp_size
-            ,webus->resp_used
-            ,buf_size);
-    }
-
-    memcpy(webus->resp_image + webus->resp_used, buf, (uint)buf_size);
-    webus->resp_used += (uint)buf_size;
+    int indx;
 
-    return buf_size;
+    device_id = p_device_id;
+    cnct_type = p_cnct_type;
+    users = 0;
+    width = 0;
+    height = 0;
+    img = nullptr;
+    img_sz = 0;
+    picture = nullptr;
+    fmtctx = nullptr;
+    ctx_codec = nullptr;
+    hdr.buf = nullptr;
+    hdr.size = 0;
+    hdr.used = 0;
+    hdr.key = false;
+    for (indx=0; indx<WEBU_TS_RING; indx++) {
+        pkts[indx].buf = nullptr;
+        pkts[indx].size = 0;
+        pkts[indx].used = 0;
+        pkts[indx].key = false;
+    }
+    pkt_wr = &hdr;
+    seq_next = 0;
+    seq_base = 0;
+    open_time.tv_sec = 0;
+    open_time.tv_nsec = 0;
+    pthread_mutex_init(&mutex, NULL);
 }
 
-ssize_t cls_webu_mpegts::response(char *buf, size_t max)
+cls_webu_tsenc::~cls_webu_tsenc()
 {
-    size_t sent_bytes;
+    int indx;
 
-    if (webus->check_finish()) {
-        return -1;
+    close();
+    myfree(hdr.buf);
+    for (indx=0; indx<WEBU_TS_RING; indx++) {
+        myfree(pkts[indx].buf);
     }
+    pthread_mutex_destroy(&mutex);
+}
 
-    if (ctx_codec != nullptr) {
-        if ((webua->device_id == 0) &&
-            ((webua->webu->allcam->info.dst_h != ctx_codec->height ) ||
-             (webua->webu->allcam->info.dst_w != ctx_codec->width))) {
-            return -1;
-        }
-    }
+/********Class Functions ****************************************************/
 
-    if (stream_pos == 0) {
-        if ((webus->time_last.tv_sec - st_mono_time.tv_sec) < 2) {
-            webus->stream_fps = 30;
-        } else {
-            webus->set_fps();
+/* Find the shared encoder for this camera and stream type or add one */
+void cls_webu_mpegts::tsenc_attach()
+{
+    std::list<cls_webu_tsenc*>::iterator it;
+
+    pthread_mutex_lock(&webu->mutex_tsenc);
+        tsenc = nullptr;
+        for (it = webu->tsenc_list.begin(); it != webu->tsenc_list.end(); it++) {
+            if (((*it)->device_id == webua->device_id) &&
+                ((*it)->cnct_type == webua->cnct_type)) {
+                tsenc = *it;
+                break;
+            }
         }
-        webus->delay();
-        resetpos();
-        if (getimg() < 0) {
-            return 0;
+        if (tsenc == nullptr) {
+            tsenc = new cls_webu_tsenc(webua->device_id, webua->cnct_type);
+            webu->tsenc_list.push_back(tsenc);
         }
-    }
-
-    /* If we don't have anything in the avio buffer at this point bail out */
-    if (webus->resp_used == 0) {
-        resetpos();
-        return 0;
-    }
-
-    if ((webus->resp_used - stream_pos) > max) {
-        sent_bytes = max;
-    } else {
-        sent_bytes = webus->resp_used - stream_pos;
-    }
-
-    memcpy(buf, webus->resp_image + stream_pos, (uint)sent_bytes);
+        tsenc->users++;
+    pthread_mutex_unlock(&webu->mutex_tsenc);
+}
 
-    stream_pos = stream_pos + sent_bytes;
-    if (stream_pos >= webus->resp_used) {
-        stream_pos = 0;
+/* Release the shared encoder and remove it when this was the last user */
+void cls_webu_mpegts::tsenc_detach()
+{
+    if (tsenc == nullptr) {
+        return;
     }
-
-    return (ssize_t)sent_bytes;
+    pthread_mutex_lock(&webu->mutex_tsenc);
+        tsenc->users--;
+        if (tsenc->users == 0) {
+            webu->tsenc_list.remove(tsenc);
+            delete tsenc;
+        }
+    pthread_mutex_unlock(&webu->mutex_tsenc);
+    tsenc = nullptr;
 }
 
-int cls_webu_mpegts::open_mpegts()
+void cls_webu_mpegts::img_size(int &img_w, int &img_h)
 {
-    int retcd, img_w, img_h;
-    char errstr[128];
-    unsigned char   *buf_image;
-    AVStream        *strm;
-    const AVCodec   *codec;
-    AVDictionary    *opts;
-    size_t          aviobuf_sz;
-
-    opts = NULL;
-    webus->stream_fps = 30;
-    aviobuf_sz = 4096;
-    clock_gettime(CLOCK_REALTIME, &start_time);
-    clock_gettime(CLOCK_MONOTONIC, &st_mono_time);
-
-    fmtctx = avformat_alloc_context();
-    fmtctx->oformat = av_guess_format("mpegts", NULL, NULL);
-    fmtctx->video_codec_id = AV_CODEC_ID_H264;
-
-    codec = avcodec_find_encoder(AV_CODEC_ID_H264);
-    strm = avformat_new_stream(fmtctx, codec);
-
     if (webua->device_id > 0) {
         if ((webua->cnct_type == WEBUI_CNCT_TS_SUB) &&
             ((webua->cam->imgs.width  % 16) == 0) &&
@@ -325,87 +510,140 @@ int cls_webu_mpegts::open_mpegts()
             img_h = webua->cam->imgs.height;
         }
     } else {
-        if (webus->all_ready() == false) {
-            return -1;
-        }
         img_w = webu->allcam->info.dst_w;
         img_h = webu->allcam->info.dst_h;
     }
+}
 
-    ctx_codec = avcodec_alloc_context3(codec);
-    ctx_codec->gop_size      = 15;
-    ctx_codec->codec_id      = AV_CODEC_ID_H264;
-    ctx_codec->codec_type    = AVMEDIA_TYPE_VIDEO;
-    ctx_codec->bit_rate      = 400000;
-    ctx_codec->width         = img_w;
-    ctx_codec->height        = img_h;
-    ctx_codec->time_base.num = 1;
-    ctx_codec->time_base.den = 90000;
-    ctx_codec->pix_fmt       = AV_PIX_FMT_YUV420P;
-    ctx_codec->max_b_frames  = 1;
-    ctx_codec->flags         |= AV_CODEC_FLAG_GLOBAL_HEADER;
-    ctx_codec->framerate.num  = 1;
-    ctx_codec->framerate.den  = 1;
-    av_opt_set(ctx_codec->priv_data, "profile", "main", 0);
-    av_opt_set(ctx_codec->priv_data, "crf", "22", 0);
-    av_opt_set(ctx_codec->priv_data, "tune", "zerolatency", 0);
-    av_opt_set(ctx_codec->priv_data, "preset", "superfast",0);
-    av_dict_set(&opts, "movflags", "empty_moov", 0);
+int cls_webu_mpegts::getimg()
+{
+    ctx_stream_data *strm;
+    int img_w, img_h, retcd;
 
-    retcd = avcodec_open2(ctx_codec, codec, &opts);
-    if (retcd < 0) {
-        av_strerror(retcd, errstr, sizeof(errstr));
-        MOTION_LOG(ERR, TYPE_STREAM, NO_ERRNO
-            ,_("Failed to open codec context for %dx%d transport stream: %s")
-            , img_w, img_h, errstr);
-        av_dict_free(&opts);
-        return -1;
+    if (webus->check_finish() == true) {
+        return 0;
     }
 
-    retcd = avcodec_parameters_from_context(strm->codecpar, ctx_codec);
-    if (retcd < 0) {
-        av_strerror(retcd, errstr, sizeof(errstr));
-        MOTION_LOG(ERR, TYPE_STREAM, NO_ERRNO
-            ,_("Failed to copy decoder parameters!: %s"), errstr);
-        av_dict_free(&opts);
-        return -1;
-    }
+    pthread_mutex_lock(&tsenc->mutex);
+        if (tsenc->due(webus->stream_fps) == false) {
+            pthread_mutex_unlock(&tsenc->mutex);
+            return 0;
+        }
 
-    if (webua->device_id == 0) {
-        webus->all_buffer();
-    } else {
-        webus->one_buffer();
-    }
+        img_size(img_w, img_h);
+        if (tsenc->open(img_w, img_h) < 0) {
+            pthread_mutex_unlock(&tsenc->mutex);
+            return -1;
+        }
 
+        if (webua->device_id > 0) {
+            /* Assign to a local pointer the stream we want */
+            if (webua->cnct_type == WEBUI_CNCT_TS_FULL) {
+                strm = &webua->cam->stream.norm;
+            } else if (webua->cnct_type == WEBUI_CNCT_TS_SUB) {
+                strm = &webua->cam->stream.sub;
+            } else if (webua->cnct_type == WEBUI_CNCT_TS_MOTION) {
+                strm = &webua->cam->stream.motion;
+            } else if (webua->cnct_type == WEBUI_CNCT_TS_SOURCE) {
+                strm = &webua->cam->stream.source;
+            } else if (webua->cnct_type == WEBUI_CNCT_TS_SECONDARY) {
+                strm = &webua->cam->stream.secondary;
+            } else {
+                pthread_mutex_unlock(&tsenc->mutex);
+                return 0;
+            }
+            pthread_mutex_lock(&webua->cam->stream.mutex);
+                if (strm->img_data == NULL) {
+                    memset(tsenc->img, 0x00, (uint)tsenc->img_sz);
+                } else {
+                    memcpy(tsenc->img, strm->img_data, (uint)tsenc->img_sz);
+                    strm->consumed = true;
+                }
+            pthread_mutex_unlock(&webua->cam->stream.mutex);
+        } else {
+            if (webua->cnct_type == WEBUI_CNCT_TS_FULL) {
+                strm = &webua->webu->allcam->stream.norm;
+            } else if (webua->cnct_type == WEBUI_CNCT_TS_SUB) {
+                strm = &webua->webu->allcam->stream.sub;
+            } else if (webua->cnct_type == WEBUI_CNCT_TS_MOTION) {
+                strm = &webua->webu->allcam->stream.motion;
+            } else if (webua->cnct_type == WEBUI_CNCT_TS_SOURCE) {
+                strm = &webua->webu->allcam->stream.source;
+            } else if (webua->cnct_type == WEBUI_CNCT_TS_SECONDARY) {
+                strm = &webua->webu->allcam->stream.secondary;
+            } else {
+                pthread_mutex_unlock(&tsenc->mutex);
+                return 0;
+            }
+            pthread_mutex_lock(&webua->webu->allcam->stream.mutex);
+                if ((strm->img_data == nullptr) ||
+                    (webu->allcam->info.dst_sz != tsenc->img_sz)) {
+                    memset(tsenc->img, 0x00, (uint)tsenc->img_sz);
+                } else {
+                    memcpy(tsenc->img, strm->img_data, (uint)tsenc->img_sz);
+                    strm->consumed = true;
+                }
+            pthread_mutex_unlock(&webua->webu->allcam->stream.mutex);
+        }
 
-    buf_image = (unsigned char*)av_malloc(aviobuf_sz);
-    fmtctx->pb = avio_alloc_context(
-        buf_image, (int)aviobuf_sz, 1, this
-        , NULL, &webu_mpegts_avio_buf, NULL);
-    fmtctx->flags = AVFMT_FLAG_CUSTOM_IO;
+        retcd = tsenc->encode();
+    pthread_mutex_unlock(&tsenc->mutex);
 
-    retcd = avformat_write_header(fmtctx, &opts);
-    if (retcd < 0) {
-        av_strerror(retcd, errstr, sizeof(errstr));
-        MOTION_LOG(ERR, TYPE_STREAM, NO_ERRNO
-            ,_("Failed to write header!: %s"), errstr);
-        av_dict_free(&opts);
+    return retcd;
+}
+
+ssize_t cls_webu_mpegts::response(char *buf, size_t max)
+{
+    ssize_t sent_bytes;
+
+    if (webus->check_finish()) {
         return -1;
     }
 
-    stream_pos = 0;
-    webus->resp_used = 0;
+    if ((webua->device_id == 0) &&
+        ((webua->webu->allcam->info.dst_h != tsenc->height ) ||
+         (webua->webu->allcam->info.dst_w != tsenc->width))) {
+        return -1;
+    }
 
-    av_dict_free(&opts);
+    sent_bytes = tsenc->read(pkt_seq, stream_pos, hdr_sent, buf, max);
+    if (sent_bytes > 0) {
+        return sent_bytes;
+    }
 
-    return 0;
+    /* Nothing new so wait for the next image and encode it if no other
+     * connection already has.
+     */
+    webus->set_fps();
+    pthread_mutex_lock(&tsenc->mutex);
+        webus->stream_fps = tsenc->rate(webus->stream_fps);
+    pthread_mutex_unlock(&tsenc->mutex);
+
+    if (webua->webu->wb_pool) {
+        if ((webus->due() == false) || (getimg() < 0)) {
+            return webus->suspend();
+        }
+        sent_bytes = tsenc->read(pkt_seq, stream_pos, hdr_sent, buf, max);
+        if (sent_bytes == 0) {
+            return webus->suspend();
+        }
+        return sent_bytes;
+    }
+
+    webus->delay();
+    webus->wait_frame();
+    if (getimg() < 0) {
+        return 0;
+    }
+
+    return tsenc->read(pkt_seq, stream_pos, hdr_sent, buf, max);
 }
 
 mhdrslt cls_webu_mpegts::main()
 {
     mhdrslt retcd;
     struct MHD_Response *response;
-    int indx;
+    int indx, img_w, img_h, retcd_open;
 
     if (webua->device_id == 0) {
         if (webus->all_ready() == false) {
@@ -413,11 +651,23 @@ mhdrslt cls_webu_mpegts::main()
         }
     }
 
-    if (open_mpegts() < 0 ) {
+    webus->stream_fps = 30;
+
+    tsenc_attach();
+    img_size(img_w, img_h);
+    pthread_mutex_lock(&tsenc->mutex);
+        retcd_open = tsenc->open(img_w, img_h);
+    pthread_mutex_unlock(&tsenc->mutex);
+    if (retcd_open < 0) {
         MOTION_LOG(ERR, TYPE_STREAM, NO_ERRNO, _("Unable to open mpegts"));
+        tsenc_detach();
         return MHD_NO;
     }
 
+    pkt_seq = -1;
+    stream_pos = 0;
+    hdr_sent = false;
+
     clock_gettime(CLOCK_MONOTONIC, &webus->time_last);
 
     response = MHD_create_response_from_callback (MHD_SIZE_UNKNOWN, 4096
@@ -452,35 +702,16 @@ cls_webu_mpegts::cls_webu_mpegts(cls_webu_ans *p_webua, cls_webu_stream *p_webus
     webua  = p_webua;
     webus  = p_webus;
 
-    stream_pos    = 0;
-    picture = nullptr;;
-    ctx_codec = nullptr;
-    fmtctx = nullptr;
+    tsenc = nullptr;
+    pkt_seq = -1;
+    stream_pos = 0;
+    hdr_sent = false;
 }
 
 cls_webu_mpegts::~cls_webu_mpegts()
 {
+    tsenc_detach();
     app    = nullptr;
     webu   = nullptr;
     webua  = nullptr;
-    if (picture != nullptr) {
-        av_frame_free(&picture);
-        picture = nullptr;
-    }
-    if (ctx_codec != nullptr) {
-        avcodec_free_context(&ctx_codec);
-        ctx_codec = nullptr;
-    }
-    if (fmtctx != nullptr) {
-        if (fmtctx->pb != nullptr) {
-            if (fmtctx->pb->buffer != nullptr) {
-                av_free(fmtctx->pb->buffer);
-                fmtctx->pb->buffer = nullptr;
-            }
-            avio_context_free(&fmtctx->pb);
-            fmtctx->pb = nullptr;
-        }
-        avformat_free_context(fmtctx);
-        fmtctx = nullptr;
-    }
 }
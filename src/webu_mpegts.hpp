@@ -19,11 +19,63 @@
 #ifndef _INCLUDE_WEBU_MPEGTS_HPP_
 #define _INCLUDE_WEBU_MPEGTS_HPP_
 
+    #define WEBU_TS_RING 64     /* Encoded packets kept for the transport stream connections */
+    #define WEBU_TS_PKTSZ 188   /* Size of a transport stream packet */
+
+    /* The muxed bytes of one encoded packet */
+    struct ctx_webu_ts_pkt {
+        u_char      *buf;
+        size_t      size;       /* The allocated size of buf */
+        size_t      used;       /* The bytes of buf in use */
+        bool        key;        /* Whether the packet is a key frame */
+    };
+
+    /* One encoder for each camera and stream type that all connections read.
+     * The connections share its packets so they all get the rate of the encoder.
+     */
+    class cls_webu_tsenc {
+        public:
+            cls_webu_tsenc(int p_device_id, enum WEBUI_CNCT p_cnct_type);
+            ~cls_webu_tsenc();
+
+            int             device_id;
+            enum WEBUI_CNCT cnct_type;
+            int             users;      /* Connections reading, locked by webu->mutex_tsenc */
+            pthread_mutex_t mutex;      /* Lock the encoder and the packets */
+            int             width;
+            int             height;
+            u_char          *img;       /* The image to be encoded */
+            int             img_sz;
+
+            int avio_buf(myuint *buf, int buf_size);
+            int open(int p_width, int p_height);
+            int rate(int fps);
+            bool due(int fps);
+            int encode();
+            ssize_t read(int64_t &seq, size_t &pos, bool &hdr
+                , char *buf, size_t max);
+
+        private:
+            AVFrame         *picture;
+            AVFormatContext *fmtctx;
+            AVCodecContext  *ctx_codec;
+            struct timespec start_time;     /* Start time of the stream */
+            struct timespec enc_time;       /* Time of the last encoded image */
+            struct timespec open_time;      /* When the encoder was opened (CLOCK_MONOTONIC) */
+            ctx_webu_ts_pkt hdr;            /* The bytes written by the muxer header */
+            ctx_webu_ts_pkt pkts[WEBU_TS_RING];
+            ctx_webu_ts_pkt *pkt_wr;        /* Where the muxer is writing */
+            int64_t         seq_next;       /* Sequence number of the next packet */
+            int64_t         seq_base;       /* Sequence number of the first packet since opening */
+
+            void close();
+            int64_t keyseq();
+    };
+
     class cls_webu_mpegts {
         public:
             cls_webu_mpegts(cls_webu_ans *p_webua, cls_webu_stream *p_webus);
             ~cls_webu_mpegts();
-            int avio_buf(myuint *buf, int buf_size);
             ssize_t response(char *buf, size_t max);
             mhdrslt main();
 
@@ -32,19 +84,16 @@
             cls_webu        *webu;
             cls_webu_ans    *webua;
             cls_webu_stream *webus;
+            cls_webu_tsenc  *tsenc;
 
-            AVFrame         *picture;
-            AVFormatContext *fmtctx;
-            AVCodecContext  *ctx_codec;
-            size_t          stream_pos;     /* Stream position of sent image */
-            struct timespec start_time;     /* Start time of the stream*/
-            struct timespec st_mono_time;
+            int64_t         pkt_seq;        /* Sequence number of the packet being sent */
+            size_t          stream_pos;     /* Position in the packet being sent */
+            bool            hdr_sent;       /* Whether the header was sent */
 
-            int pic_send(unsigned char *img);
-            int pic_get();
-            void resetpos();
+            void tsenc_attach();
+            void tsenc_detach();
+            void img_size(int &img_w, int &img_h);
             int getimg();
-            int open_mpegts();
     };
 
 #endif /* _INCLUDE_WEBU_MPEGTS_HPP_ */
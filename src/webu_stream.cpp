@@ -29,6 +29,7 @@
 #include "webu_mpegts.hpp"
 #include "alg_sec.hpp"
 #include "jpegutils.hpp"
+#include "webu_getimg.hpp"
 
 static ssize_t webu_mjpeg_response (void *cls, uint64_t pos, char *buf, size_t max)
 {
@@ -89,33 +90,154 @@ void cls_webu_stream::delay()
     clock_gettime(CLOCK_MONOTONIC, &time_last);
 }
 
-void cls_webu_stream::one_buffer()
+/* Determine whether the next image is due for the user requested framerate.
+ * This is the non blocking version of delay used when the connections
+ * share a thread pool.
+ */
+bool cls_webu_stream::due()
 {
-    if (webua->cam == NULL) {
+    struct timespec time_curr;
+    long   stream_delay;
+
+    if (stream_fps < 1) {
+        return true;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &time_curr);
+
+    stream_delay = ((time_curr.tv_nsec - time_last.tv_nsec)) +
+        ((time_curr.tv_sec - time_last.tv_sec)*1000000000);
+    if (stream_delay < (1000000000 / stream_fps)) {
+        return false;
+    }
+
+    time_last = time_curr;
+    return true;
+}
+
+/* Get the camera or all camera stream that this connection reads */
+ctx_stream *cls_webu_stream::get_stream()
+{
+    if (webua->device_id == 0) {
+        return &webu->allcam->stream;
+    } else if (webua->cam == NULL) {
+        return NULL;
+    } else {
+        return &webua->cam->stream;
+    }
+}
+
+/* Suspend the connection until the camera provides its next image.
+ * Returns zero so MHD retries once resumed or -1 when the stream is ending.
+ */
+ssize_t cls_webu_stream::suspend()
+{
+    ctx_stream *strm;
+
+    strm = get_stream();
+    if (strm == NULL) {
+        return -1;
+    }
+
+    /* Checked under the lock so that a shutdown wake can not be missed */
+    pthread_mutex_lock(&strm->mutex);
+        if (check_finish()) {
+            pthread_mutex_unlock(&strm->mutex);
+            return -1;
+        }
+        strm->wait_list.push_back(webua->connection);
+        MHD_suspend_connection(webua->connection);
+    pthread_mutex_unlock(&strm->mutex);
+
+    return 0;
+}
+
+/* Block until the camera publishes an image newer than the last one seen.
+ * The wait is limited to a second so the previous image is resent and
+ * the finish flags are checked while the camera is not publishing.
+ */
+void cls_webu_stream::wait_frame()
+{
+    ctx_stream *strm;
+    struct timespec ts;
+
+    strm = get_stream();
+    if (strm == NULL) {
         return;
     }
-    if (resp_size < (size_t)webua->cam->imgs.size_norm) {
-        if (resp_image != NULL) {
-            myfree(resp_image);
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_sec++;
+    pthread_mutex_lock(&strm->mutex);
+        while ((strm->frame_seq == frame_seq) && (check_finish() == false)) {
+            if (pthread_cond_timedwait(&strm->cond, &strm->mutex, &ts) != 0) {
+                break;
+            }
         }
-        resp_image = (unsigned char*) mymalloc((uint)webua->cam->imgs.size_norm);
-        memset(resp_image,'\0', (uint)webua->cam->imgs.size_norm);
-        resp_size = (uint)webua->cam->imgs.size_norm;
-        resp_used = 0;
+        frame_seq = strm->frame_seq;
+    pthread_mutex_unlock(&strm->mutex);
+}
+
+/* Use the jpg as the next part of the mjpeg stream */
+void cls_webu_stream::mjpeg_set(ctx_stream_jpg *jpg)
+{
+    webu_getimg_jpg_put(resp_jpg);
+    resp_used = 0;
+    if (jpg == NULL) {
+        return;
     }
+
+    resp_jpg = jpg;
+    resp_head_len = (size_t)snprintf(resp_head, sizeof(resp_head)
+        ,"--BoundaryString\r\n"
+        "Content-type: image/jpeg\r\n"
+        "Content-Length: %9d\r\n\r\n"
+        ,jpg->sz);
+    resp_used = resp_head_len + (size_t)jpg->sz + 2;
 }
 
-void cls_webu_stream::all_buffer()
+/* Copy the next portion of the mjpeg part.  The part is sent straight from
+ * the header, the shared jpg and the terminator without assembling it.
+ */
+size_t cls_webu_stream::mjpeg_copy(char *buf, size_t max)
 {
-    if (resp_size < (size_t)webu->allcam->info.dst_sz) {
-        if (resp_image != nullptr) {
-            myfree(resp_image);
+    size_t sent_bytes, part_end, len;
+
+    sent_bytes = 0;
+
+    if (stream_pos < resp_head_len) {
+        len = resp_head_len - stream_pos;
+        if (len > max) {
+            len = max;
         }
-        resp_size = (uint)webu->allcam->info.dst_sz;
-        resp_image = (unsigned char*) mymalloc(resp_size);
-        memset(resp_image, '\0', resp_size);
-        resp_used = 0;
+        memcpy(buf, resp_head + stream_pos, len);
+        stream_pos += len;
+        sent_bytes += len;
+    }
+
+    part_end = resp_head_len + (size_t)resp_jpg->sz;
+    if ((stream_pos < part_end) && (sent_bytes < max)) {
+        len = part_end - stream_pos;
+        if (len > (max - sent_bytes)) {
+            len = max - sent_bytes;
+        }
+        memcpy(buf + sent_bytes
+            , resp_jpg->data + (stream_pos - resp_head_len), len);
+        stream_pos += len;
+        sent_bytes += len;
     }
+
+    if ((stream_pos < resp_used) && (sent_bytes < max)) {
+        len = resp_used - stream_pos;
+        if (len > (max - sent_bytes)) {
+            len = max - sent_bytes;
+        }
+        memcpy(buf + sent_bytes, "\r\n" + (stream_pos - part_end), len);
+        stream_pos += len;
+        sent_bytes += len;
+    }
+
+    return sent_bytes;
 }
 
 bool cls_webu_stream::check_finish()
@@ -136,20 +258,28 @@ bool cls_webu_stream::check_finish()
 
 bool cls_webu_stream::all_ready()
 {
-    int indx, indx1;
+    int indx;
     cls_camera *p_cam;
+    struct timespec ts;
 
     for (indx=0; indx<webu->cam_cnt; indx++) {
         p_cam = webu->cam_list[indx];
         if ((p_cam->device_status == STATUS_OPENED) &&
             (p_cam->passflag == false)) {
-            indx1 = 0;
-            while (indx1 < 1000) {
-                SLEEP(0, 1000);
-                if (p_cam->passflag) {
-                    break;
-                }
-                indx1++;
+            /* The camera signals each image so wait on it for up to a second.
+             * A pool thread is not held here, all_wait suspends instead.
+             */
+            if (webu->wb_pool == false) {
+                clock_gettime(CLOCK_MONOTONIC, &ts);
+                ts.tv_sec++;
+                pthread_mutex_lock(&p_cam->stream.mutex);
+                    while (p_cam->passflag == false) {
+                        if (pthread_cond_timedwait(&p_cam->stream.cond
+                            , &p_cam->stream.mutex, &ts) != 0) {
+                            break;
+                        }
+                    }
+                pthread_mutex_unlock(&p_cam->stream.mutex);
             }
             if (p_cam->passflag == false) {
                 MOTION_LOG(DBG, TYPE_STREAM, NO_ERRNO
@@ -167,11 +297,37 @@ bool cls_webu_stream::all_ready()
     return true;
 }
 
+/* Count the all camera connection and with the thread pool suspend it
+ * until the cameras are ready.  The request is answered again once the
+ * all camera stream resumes it.  Returns true when suspended.
+ */
+bool cls_webu_stream::all_wait()
+{
+    struct timespec curr_ts;
+
+    if (all_counted == false) {
+        all_cnct();
+        all_counted = true;
+        clock_gettime(CLOCK_MONOTONIC, &all_wait_ts);
+    }
+
+    if ((webu->wb_pool == false) || (all_ready() == true)) {
+        return false;
+    }
+
+    /* Give up after a second as the wait in all_ready does */
+    clock_gettime(CLOCK_MONOTONIC, &curr_ts);
+    if ((curr_ts.tv_sec - all_wait_ts.tv_sec) > 1) {
+        return false;
+    }
+
+    return (suspend() == 0);
+}
+
 void cls_webu_stream::mjpeg_all_img()
 {
-    char resp_head[80];
-    int  header_len;
     ctx_stream_data *strm;
+    ctx_stream_jpg *jpg;
 
     if (check_finish()) {
         return;
@@ -181,10 +337,6 @@ void cls_webu_stream::mjpeg_all_img()
         return;
     }
 
-    all_buffer();
-
-    memset(resp_image, '\0', resp_size);
-
     /* Assign to a local pointer the stream we want */
     if (webua->app == NULL) {
         return;
@@ -205,39 +357,25 @@ void cls_webu_stream::mjpeg_all_img()
     /* Copy jpg from the motion loop thread */
     pthread_mutex_lock(&webua->webu->allcam->stream.mutex);
         set_fps();
-        if (strm->jpg_data == NULL) {
-            pthread_mutex_unlock(&webua->webu->allcam->stream.mutex);
-            return;
+        jpg = webu_getimg_jpg_get(strm);
+        if (jpg != NULL) {
+            strm->consumed = true;
         }
-        header_len = snprintf(resp_head, 80
-            ,"--BoundaryString\r\n"
-            "Content-type: image/jpeg\r\n"
-            "Content-Length: %9d\r\n\r\n"
-            ,strm->jpg_sz);
-        memcpy(resp_image, resp_head, (uint)header_len);
-        memcpy(resp_image + header_len
-            , strm->jpg_data
-            , (uint)strm->jpg_sz);
-        /* Copy in the terminator after the jpg data at the end*/
-        memcpy(resp_image + header_len + strm->jpg_sz,"\r\n",2);
-        resp_used =(uint)(header_len + strm->jpg_sz + 2);
-        strm->consumed = true;
     pthread_mutex_unlock(&webua->webu->allcam->stream.mutex);
 
+    mjpeg_set(jpg);
+
 }
 
 void cls_webu_stream::mjpeg_one_img()
 {
-    char resp_head[80];
-    int  header_len;
     ctx_stream_data *strm;
+    ctx_stream_jpg *jpg;
 
     if (check_finish()) {
         return;
     }
 
-    memset(resp_image, '\0', resp_size);
-
     /* Assign to a local pointer the stream we want */
     if (webua->cam == NULL) {
         return;
@@ -258,25 +396,14 @@ void cls_webu_stream::mjpeg_one_img()
     /* Copy jpg from the motion loop thread */
     pthread_mutex_lock(&webua->cam->stream.mutex);
         set_fps();
-        if (strm->jpg_data == NULL) {
-            pthread_mutex_unlock(&webua->cam->stream.mutex);
-            return;
+        jpg = webu_getimg_jpg_get(strm);
+        if (jpg != NULL) {
+            strm->consumed = true;
         }
-        header_len = snprintf(resp_head, 80
-            ,"--BoundaryString\r\n"
-            "Content-type: image/jpeg\r\n"
-            "Content-Length: %9d\r\n\r\n"
-            ,strm->jpg_sz);
-        memcpy(resp_image, resp_head, (uint)header_len);
-        memcpy(resp_image + header_len
-            , strm->jpg_data
-            , (uint)strm->jpg_sz);
-        /* Copy in the terminator after the jpg data at the end*/
-        memcpy(resp_image + header_len + strm->jpg_sz,"\r\n",2);
-        resp_used =(uint)(header_len + strm->jpg_sz + 2);
-        strm->consumed = true;
     pthread_mutex_unlock(&webua->cam->stream.mutex);
 
+    mjpeg_set(jpg);
+
 }
 
 ssize_t cls_webu_stream::mjpeg_response (char *buf, size_t max)
@@ -289,7 +416,14 @@ ssize_t cls_webu_stream::mjpeg_response (char *buf, size_t max)
 
     if ((stream_pos == 0) || (resp_used == 0)) {
 
-        delay();
+        if (webu->wb_pool) {
+            if (due() == false) {
+                return suspend();
+            }
+        } else {
+            delay();
+            wait_frame();
+        }
 
         stream_pos = 0;
         resp_used = 0;
@@ -301,19 +435,15 @@ ssize_t cls_webu_stream::mjpeg_response (char *buf, size_t max)
         }
 
         if (resp_used == 0) {
+            if (webu->wb_pool) {
+                return suspend();
+            }
             return 0;
         }
     }
 
-    if ((resp_used - stream_pos) > max) {
-        sent_bytes = max;
-    } else {
-        sent_bytes = resp_used - stream_pos;
-    }
+    sent_bytes = mjpeg_copy(buf, max);
 
-    memcpy(buf, resp_image + stream_pos, sent_bytes);
-
-    stream_pos = stream_pos + sent_bytes;
     if (stream_pos >= resp_used) {
         stream_pos = 0;
     }
@@ -373,10 +503,8 @@ void cls_webu_stream::static_all_img()
         return;
     }
 
-    all_buffer();
-
+    webu_getimg_jpg_put(resp_jpg);
     resp_used = 0;
-    memset(resp_image, '\0', resp_size);
 
     /* Assign to a local pointer the stream we want */
     if (webua->cnct_type == WEBUI_CNCT_JPG_FULL) {
@@ -394,15 +522,11 @@ void cls_webu_stream::static_all_img()
     }
 
     pthread_mutex_lock(&webua->webu->allcam->stream.mutex);
-        if (strm->jpg_data == NULL) {
-            pthread_mutex_unlock(&webua->webu->allcam->stream.mutex);
-            return;
+        resp_jpg = webu_getimg_jpg_get(strm);
+        if (resp_jpg != NULL) {
+            resp_used = (size_t)resp_jpg->sz;
+            strm->consumed = true;
         }
-        memcpy(resp_image
-            , strm->jpg_data
-            , (uint)strm->jpg_sz);
-        resp_used =(uint)strm->jpg_sz;
-        strm->consumed = true;
     pthread_mutex_unlock(&webua->webu->allcam->stream.mutex);
 
 }
@@ -445,10 +569,8 @@ void cls_webu_stream::static_one_img()
 {
     ctx_stream_data *strm;
 
-    one_buffer();
-
+    webu_getimg_jpg_put(resp_jpg);
     resp_used = 0;
-    memset(resp_image, '\0', resp_size);
 
     /* Assign to a local pointer the stream we want */
     if (webua->cam == NULL) {
@@ -468,15 +590,11 @@ void cls_webu_stream::static_one_img()
     }
 
     pthread_mutex_lock(&webua->cam->stream.mutex);
-        if (strm->jpg_data == NULL) {
-            pthread_mutex_unlock(&webua->cam->stream.mutex);
-            return;
+        resp_jpg = webu_getimg_jpg_get(strm);
+        if (resp_jpg != NULL) {
+            resp_used = (size_t)resp_jpg->sz;
+            strm->consumed = true;
         }
-        memcpy(resp_image
-            , strm->jpg_data
-            , (uint)strm->jpg_sz);
-        resp_used =(uint)strm->jpg_sz;
-        strm->consumed = true;
     pthread_mutex_unlock(&webua->cam->stream.mutex);
 
 }
@@ -611,8 +729,9 @@ mhdrslt cls_webu_stream::stream_static()
     }
 
     response = MHD_create_response_from_buffer (
-            resp_size,(void *)resp_image
+            resp_used,(void *)resp_jpg->data
             , MHD_RESPMEM_MUST_COPY);
+    webu_getimg_jpg_put(resp_jpg);
     if (response == NULL) {
         MOTION_LOG(ERR, TYPE_STREAM, NO_ERRNO, _("Invalid response"));
         return MHD_NO;
@@ -652,15 +771,17 @@ void cls_webu_stream::main()
             jpg_cnct();
             static_one_img();
         } else {
-            all_cnct();
+            if (all_wait()) {
+                return;
+            }
             static_all_img();
         }
         retcd = stream_static();
     } else if (webua->uri_cmd1 == "mpegts") {
         if (webua->device_id > 0) {
             ts_cnct();
-        } else {
-            all_cnct();
+        } else if (all_wait()) {
+            return;
         }
         if (webu_mpegts == nullptr){
             webu_mpegts = new cls_webu_mpegts(webua, this);
@@ -672,10 +793,8 @@ void cls_webu_stream::main()
     } else {
         if (webua->device_id > 0) {
             jpg_cnct();
-            one_buffer();
         } else {
             all_cnct();
-            all_buffer();
         }
         retcd = stream_mjpeg();
     }
@@ -693,12 +812,15 @@ cls_webu_stream::cls_webu_stream(cls_webu_ans *p_webua)
     webua  = p_webua;
     webu_mpegts = nullptr;
 
-    resp_image    = nullptr;
-    resp_size     = 0;
+    resp_jpg      = nullptr;
     resp_used     = 0;
+    resp_head_len = 0;
 
     stream_pos = 0;
+    frame_seq  = 0;
     stream_fps = 1;
+    all_counted = false;
+    memset(&all_wait_ts, 0, sizeof(struct timespec));
 
 }
 
@@ -706,6 +828,6 @@ cls_webu_stream::~cls_webu_stream()
 {
     mydelete(webu_mpegts);
 
-    myfree(resp_image);
+    webu_getimg_jpg_put(resp_jpg);
 
 }
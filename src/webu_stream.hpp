@@ -24,17 +24,17 @@
             ~cls_webu_stream();
 
             int     stream_fps;
-            size_t  resp_size;      /* The allocated size of the response */
             size_t  resp_used;      /* The amount of the response page used */
-            u_char  *resp_image;    /* Response image to provide to user */
+            ctx_stream_jpg  *resp_jpg;  /* Shared jpg being provided to user */
 
             void main();
             ssize_t mjpeg_response (char *buf, size_t max);
             bool check_finish();
             void delay();
+            bool due();
+            ssize_t suspend();
+            void wait_frame();
             void set_fps();
-            void one_buffer();
-            void all_buffer();
             bool all_ready();
             struct timespec time_last;      /* Keep track of processing time for stream thread*/
 
@@ -45,7 +45,17 @@
             cls_webu_mpegts *webu_mpegts;
 
             size_t          stream_pos;
+            char            resp_head[80];  /* Multipart header for resp_jpg */
+            size_t          resp_head_len;
+            uint64_t        frame_seq;      /* Last image sequence seen from the camera */
+            bool            all_counted;    /* The all camera connection has been counted */
+            struct timespec all_wait_ts;    /* When the all camera connection was counted */
 
+            ctx_stream *get_stream();
+            bool all_wait();
+
+            void mjpeg_set(ctx_stream_jpg *jpg);
+            size_t mjpeg_copy(char *buf, size_t max);
             void mjpeg_all_img();
             void mjpeg_one_img();
             void static_all_img();